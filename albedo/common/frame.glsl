@@ -0,0 +1,19 @@
+/**
+	Per-frame constants shared by all renderer programs
+	(must correspond to deferred_renderer::ubo_frame_data in C++)
+*/
+
+layout (std140, binding = 0) uniform FRAME_UBO
+{
+	mat4 mat_view;
+	mat4 mat_proj;           //!< Includes jitter
+	mat4 mat_vp;
+	mat4 mat_inv_view;
+	mat4 mat_inv_proj;
+	mat4 mat_inv_vp;
+	vec2 viewport_size;      //!< In pixels
+	vec2 inv_viewport_size;
+	vec2 jitter;             //!< Sub-pixel projection offset in pixels
+	float time;              //!< Seconds since the renderer was created
+	float delta_time;        //!< Seconds since the previous frame
+} frame;
@@ -0,0 +1,79 @@
+/**
+	PBR lighting functions shared between programs
+*/
+
+#define M_PI 3.141592653589793238462643383279502884
+
+/**
+	Trowbridge-Reitz GGX normal distribution function
+	a - roughness
+*/
+float trowbridge_reitz_ggx(in vec3 N, in vec3 H, in float a)
+{
+	float N_dot_H = max(dot(N, H), 0);
+	float a_sq = a * a;
+	float tmp = N_dot_H * N_dot_H * (a_sq - 1) + 1;
+	return a_sq / (tmp * tmp * M_PI);
+}
+
+/**
+	Schlick GGX geometry function
+	k - roughness scaled
+		k_direct = (a+1)^2/8
+		k_IBL    = a^2/2
+*/
+float schlick_ggx(in vec3 N, in vec3 V, in float k)
+{
+	float tmp = max(dot(N, V), 0);
+	return tmp / (tmp * (1 - k) + k);
+}
+
+/**
+	Geometry function taking into account both geometry obstruction and geometry shadowing.
+	Based on Schlick GGX.
+
+	\todo This can be further optimized by passing only dot(N, V) to the schlick_ggx
+*/
+float smith_schlick(in vec3 N, in vec3 V, in vec3 L, in float k)
+{
+	return schlick_ggx(N, V, k) * schlick_ggx(N, L, k);
+}
+
+/**
+	Fresnel-Schlick approximation
+*/
+vec3 fresnel_schlick(in vec3 H, in vec3 V, in vec3 F0)
+{
+	return F0 + (1 - F0) * pow(1 - dot(H, V), 5);
+}
+
+/**
+	PBR lighting model (Cook-Torrance)
+*/
+vec3 pbr(in vec3 N, in vec3 L, in vec3 V, in vec3 albedo, in float roughness, in float metallic, in vec3 radiance)
+{
+	vec3 H = normalize(L + V);
+	vec3 F0 = mix(vec3(0.04), albedo, metallic);
+
+	// Calculate a and k based on roughness
+	float a = roughness;
+	float k = pow(a + 1, 2) / 8;
+
+	// Normal distribution function, geometry function and Frensel equation
+	float NDF = trowbridge_reitz_ggx(N, H, a);
+	float GF  = smith_schlick(N, V, L, k);
+	vec3 F = fresnel_schlick(H, V, F0);
+
+	// Specular and diffuse term intensities
+	vec3 k_s = F;
+	vec3 k_d = (1 - k_s) * (1 - metallic);
+
+	// Specular term
+	vec3 specular = NDF * GF * F / max(4 * max(dot(N, V), 0) * max(dot(N, L), 0), 0.001);
+
+	// Difuse term
+	vec3 diffuse = (vec3(1) - k_s) * albedo / M_PI;
+
+	//return F;
+	return (specular + diffuse) * radiance * max(dot(N, L), 0);
+}
@@ -0,0 +1,64 @@
+#version 450 core
+
+// Must correspond to deferred_renderer::histogram_bin_count
+#define HISTOGRAM_BINS 256
+
+layout (local_size_x = HISTOGRAM_BINS) in;
+
+// Log2 luminance range covered by the histogram
+uniform float min_log_luminance;
+uniform float log_luminance_range;
+
+// Number of pixels in the histogram
+uniform int pixel_count;
+
+// Blending factor between previous and current average luminance
+uniform float adaptation_rate;
+
+// Luminance mapped to middle grey
+uniform float exposure_key;
+
+layout (std430, binding = 0) buffer HISTOGRAM_SSBO
+{
+	uint bins[HISTOGRAM_BINS];
+} histogram;
+
+layout (std430, binding = 1) buffer EXPOSURE_SSBO
+{
+	float average_luminance;
+	float exposure;
+} exposure_data;
+
+shared float weighted_bins[HISTOGRAM_BINS];
+
+void main()
+{
+	uint i = gl_LocalInvocationIndex;
+
+	// Read the bin and clear it for the next frame
+	uint count = histogram.bins[i];
+	histogram.bins[i] = 0;
+	weighted_bins[i] = float(count) * float(i);
+	barrier();
+
+	// Parallel reduction
+	for (uint stride = HISTOGRAM_BINS / 2; stride > 0; stride >>= 1)
+	{
+		if (i < stride)
+			weighted_bins[i] += weighted_bins[i + stride];
+		barrier();
+	}
+
+	if (i == 0)
+	{
+		// Black pixels (bin 0, which is held by this invocation) are not taken into account
+		float valid_count = max(float(pixel_count) - float(count), 1);
+		float mean_bin = max(weighted_bins[0] / valid_count - 1, 0);
+		float mean_log_luminance = mean_bin / (HISTOGRAM_BINS - 2) * log_luminance_range + min_log_luminance;
+
+		// Adapt smoothly
+		float luminance = mix(exposure_data.average_luminance, exp2(mean_log_luminance), adaptation_rate);
+		exposure_data.average_luminance = luminance;
+		exposure_data.exposure = exposure_key / max(luminance, 0.0001);
+	}
+}
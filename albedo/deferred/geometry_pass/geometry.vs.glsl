@@ -1,16 +1,17 @@
 #version 450 core
 
+#include <common/frame.glsl>
+
 // Standard input attributes layout
 layout (location = 0) in vec3 v_pos;
 layout (location = 1) in vec3 v_normal;
 layout (location = 2) in vec2 v_uv;
 
 uniform mat4 mat_model;
-uniform mat4 mat_view;
-uniform mat4 mat_proj;
-uniform mat4 mat_vp;
-uniform mat4 mat_mv;
-uniform mat4 mat_mvp;
+
+// Dequantization of positions (identity for unquantized formats)
+uniform vec3 position_scale;
+uniform vec3 position_bias;
 
 out struct VS_OUT
 {
@@ -21,9 +22,10 @@ out struct VS_OUT
 
 void main()
 {
-	vs_out.v_pos = (mat_view * mat_model * vec4(v_pos, 1)).xyz;
-	vs_out.v_normal = (mat_view * mat_model * vec4(v_normal, 0)).xyz;
+	vec3 pos = v_pos * position_scale + position_bias;
+	vs_out.v_pos = (frame.mat_view * mat_model * vec4(pos, 1)).xyz;
+	vs_out.v_normal = (frame.mat_view * mat_model * vec4(v_normal, 0)).xyz;
 
 	// Projected vertex position
-	gl_Position = mat_mvp * vec4(v_pos, 1);
+	gl_Position = frame.mat_vp * mat_model * vec4(pos, 1);
 }
\ No newline at end of file
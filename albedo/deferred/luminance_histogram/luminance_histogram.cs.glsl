@@ -0,0 +1,56 @@
+#version 450 core
+
+// Must correspond to deferred_renderer::histogram_bin_count
+#define HISTOGRAM_BINS 256
+
+// One invocation per histogram bin
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// HDR color buffer
+layout (binding = 0) uniform sampler2D input_tex;
+
+// Log2 luminance range covered by the histogram
+uniform float min_log_luminance;
+uniform float inv_log_luminance_range;
+
+layout (std430, binding = 0) buffer HISTOGRAM_SSBO
+{
+	uint bins[HISTOGRAM_BINS];
+} histogram;
+
+shared uint local_bins[HISTOGRAM_BINS];
+
+/**
+	Maps HDR color to a histogram bin. Bin 0 is reserved for (nearly) black
+	pixels, so they do not drag the average down.
+*/
+uint luminance_to_bin(in vec3 color)
+{
+	float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+	if (luminance < 0.0001)
+		return 0;
+
+	float t = clamp((log2(luminance) - min_log_luminance) * inv_log_luminance_range, 0, 1);
+	return uint(t * (HISTOGRAM_BINS - 2) + 1);
+}
+
+void main()
+{
+	local_bins[gl_LocalInvocationIndex] = 0;
+	barrier();
+
+	// Accumulate in shared memory first
+	ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = textureSize(input_tex, 0);
+	if (pos.x < size.x && pos.y < size.y)
+	{
+		vec3 color = texelFetch(input_tex, pos, 0).rgb;
+		atomicAdd(local_bins[luminance_to_bin(color)], 1);
+	}
+	barrier();
+
+	// Only then merge with the global histogram
+	uint count = local_bins[gl_LocalInvocationIndex];
+	if (count > 0)
+		atomicAdd(histogram.bins[gl_LocalInvocationIndex], count);
+}
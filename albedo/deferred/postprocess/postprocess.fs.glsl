@@ -2,7 +2,14 @@
 
 layout (location = 0) out vec3 f_out;
 
-uniform sampler2D input_tex;
+layout (binding = 0) uniform sampler2D input_tex;
+
+// Written by the exposure adaptation pass
+layout (std430, binding = 1) readonly buffer EXPOSURE_SSBO
+{
+	float average_luminance;
+	float exposure;
+} exposure_data;
 
 in struct VS_OUT
 {
@@ -13,6 +20,9 @@ void main()
 {
 	vec3 f_color = texture(input_tex, vs_out.v_uv.xy).xyz;
 
+	// Automatic exposure
+	f_color *= exposure_data.exposure;
+
 	// Reinard tonemapping
 	f_color = f_color / (f_color + vec3(1));
 
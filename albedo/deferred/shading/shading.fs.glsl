@@ -1,6 +1,7 @@
 #version 450 core
 
-#define M_PI 3.141592653589793238462643383279502884
+#include <common/pbr.glsl>
+#include <common/frame.glsl>
 
 // FIXME
 #define MAX_LIGHT_COUNT 128
@@ -12,16 +13,11 @@
 
 layout (location = 0) out vec3 f_color;
 
-// Standard G-buffer layout
-uniform sampler2D tex_position;
-uniform sampler2D tex_normal;
-uniform sampler2D tex_diffuse;
-uniform sampler2D tex_specular;
-
-// All view matrices
-uniform mat4 mat_view;
-uniform mat4 mat_proj;
-uniform mat4 mat_vp;
+// Standard G-buffer layout (texture units must correspond to deferred_renderer)
+layout (binding = 1) uniform sampler2D tex_position;
+layout (binding = 2) uniform sampler2D tex_normal;
+layout (binding = 3) uniform sampler2D tex_diffuse;
+layout (binding = 4) uniform sampler2D tex_specular;
 
 // Light data (must correspond to ubo_light_data in C++)
 struct ubo_light_data
@@ -36,7 +32,7 @@ struct ubo_light_data
 // UBO with lights data
 uniform int base_light_index;
 uniform int light_count;
-layout (std140) uniform LIGHTS_UBO
+layout (std140, binding = 1) uniform LIGHTS_UBO
 {
 	ubo_light_data lights_data[MAX_LIGHT_COUNT];
 } lights_ubo;
@@ -103,80 +99,6 @@ vec3 phong(in vec3 N, in vec3 L, in vec3 V, in vec3 diffuse, in vec3 specular, i
 	return diffuse * clamp(dot(N, -L), 0, 1) + specular * pow(clamp(dot(R, V), 0, 1), specular_exponent);
 }
 
-/**
-	Trowbridge-Reitz GGX normal distribution function
-	a - roughness
-*/
-float trowbridge_reitz_ggx(in vec3 N, in vec3 H, in float a)
-{
-	float N_dot_H = max(dot(N, H), 0);
-	float a_sq = a * a;
-	float tmp = N_dot_H * N_dot_H * (a_sq - 1) + 1;
-	return a_sq / (tmp * tmp * M_PI);
-}
-
-/**
-	Schlick GGX geometry function
-	k - roughness scaled
-		k_direct = (a+1)^2/8
-		k_IBL    = a^2/2
-*/
-float schlick_ggx(in vec3 N, in vec3 V, in float k)
-{
-	float tmp = max(dot(N, V), 0);
-	return tmp / (tmp * (1 - k) + k);
-}
-
-/**
-	Geometry function taking into account both geometry obstruction and geometry shadowing.
-	Based on Schlick GGX.
-
-	\todo This can be further optimized by passing only dot(N, V) to the schlick_ggx
-*/
-float smith_schlick(in vec3 N, in vec3 V, in vec3 L, in float k)
-{
-	return schlick_ggx(N, V, k) * schlick_ggx(N, L, k);
-}
-
-/**
-	Fresnel-Schlick approximation
-*/
-vec3 fresnel_schlick(in vec3 H, in vec3 V, in vec3 F0)
-{
-	return F0 + (1 - F0) * pow(1 - dot(H, V), 5);
-}
-
-/**
-	PBR lighting model (Cook-Torrance)
-*/
-vec3 pbr(in vec3 N, in vec3 L, in vec3 V, in vec3 albedo, in float roughness, in float metallic, in vec3 radiance)
-{
-	vec3 H = normalize(L + V);
-	vec3 F0 = mix(vec3(0.04), albedo, metallic);
-
-	// Calculate a and k based on roughness
-	float a = roughness;
-	float k = pow(a + 1, 2) / 8;
-
-	// Normal distribution function, geometry function and Frensel equation
-	float NDF = trowbridge_reitz_ggx(N, H, a);
-	float GF  = smith_schlick(N, V, L, k);
-	vec3 F = fresnel_schlick(H, V, F0);
-
-	// Specular and diffuse term intensities
-	vec3 k_s = F;
-	vec3 k_d = (1 - k_s) * (1 - metallic);
-
-	// Specular term
-	vec3 specular = NDF * GF * F / max(4 * max(dot(N, V), 0) * max(dot(N, L), 0), 0.001);
-
-	// Difuse term
-	vec3 diffuse = (vec3(1) - k_s) * albedo / M_PI;
-
-	//return F;
-	return (specular + diffuse) * radiance * max(dot(N, L), 0);
-}
-
 void main()
 {
 	vec3 f_pos      = texture(tex_position, vs_out.v_uv.xy).xyz;
@@ -200,9 +122,9 @@ void main()
 	{
 		// Unpack the data from the UBO
 		int   l_type = lights_ubo.lights_data[i].type;
-		vec3  l_pos = (mat_view * vec4(lights_ubo.lights_data[i].position_distance.xyz, 1)).xyz;
+		vec3  l_pos = (frame.mat_view * vec4(lights_ubo.lights_data[i].position_distance.xyz, 1)).xyz;
 		float l_max_dist = lights_ubo.lights_data[i].position_distance.w;
-		vec3  l_dir = (mat_view * vec4(lights_ubo.lights_data[i].direction_angle.xyz, 0)).xyz;
+		vec3  l_dir = (frame.mat_view * vec4(lights_ubo.lights_data[i].direction_angle.xyz, 0)).xyz;
 		float l_angle = lights_ubo.lights_data[i].direction_angle.w;
 		vec3  l_color = lights_ubo.lights_data[i].color_specular.xyz;
 		float l_specular = lights_ubo.lights_data[i].color_specular.w;
@@ -0,0 +1,69 @@
+# Generates a C++ source file with contents of all shaders in SHADER_DIR
+# and SPIR-V modules in SPIRV_DIR embedded as static data
+# (see include/albedo/shader_files.hpp). Both directories are optional.
+#
+# Usage: cmake [-DSHADER_DIR=<dir>] [-DSPIRV_DIR=<dir>] -DOUTPUT=<file> -P embed_shaders.cmake
+
+set(content "// Generated by cmake/embed_shaders.cmake - do not edit\n")
+string(APPEND content "#include <albedo/shader_files.hpp>\n")
+string(APPEND content "#include <cstdint>\n\n")
+
+# Shader sources as raw string literals
+set(shaders)
+if (SHADER_DIR)
+	file(GLOB_RECURSE shaders RELATIVE "${SHADER_DIR}" "${SHADER_DIR}/*.glsl")
+	list(SORT shaders)
+endif()
+
+if (shaders)
+	string(APPEND content "static constexpr abd::embedded_file shader_data[] =\n{\n")
+	foreach(shader ${shaders})
+		file(READ "${SHADER_DIR}/${shader}" source)
+		string(APPEND content "\t{\"${shader}\", R\"abd_glsl(${source})abd_glsl\"},\n")
+	endforeach()
+	string(APPEND content "};\n\n")
+	string(APPEND content "const abd::embedded_file *const abd::embedded_shaders = shader_data;\n")
+	string(APPEND content "const std::size_t abd::embedded_shader_count = sizeof(shader_data) / sizeof(shader_data[0]);\n\n")
+else()
+	string(APPEND content "const abd::embedded_file *const abd::embedded_shaders = nullptr;\n")
+	string(APPEND content "const std::size_t abd::embedded_shader_count = 0;\n\n")
+endif()
+
+# SPIR-V modules as arrays of 32-bit words, so glShaderBinary() gets
+# aligned data (named after their GLSL sources)
+set(modules)
+if (SPIRV_DIR)
+	file(GLOB_RECURSE modules RELATIVE "${SPIRV_DIR}" "${SPIRV_DIR}/*.spv")
+	list(SORT modules)
+endif()
+
+if (modules)
+	set(files)
+	set(index 0)
+	foreach(module ${modules})
+		file(READ "${SPIRV_DIR}/${module}" data HEX)
+		string(LENGTH "${data}" length)
+		math(EXPR remainder "${length} % 8")
+		if (NOT remainder EQUAL 0)
+			message(FATAL_ERROR "SPIR-V module ${module} size is not a multiple of 4 bytes")
+		endif()
+
+		# Words are assembled from little-endian bytes (as written by glslangValidator
+		# on little-endian hosts), so the arrays hold the exact module contents
+		string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])" "0x\\4\\3\\2\\1," data "${data}")
+		string(APPEND content "alignas(4) static const std::uint32_t spirv_${index}[] = {${data}};\n")
+
+		string(REGEX REPLACE "\\.spv$" "" name "${module}")
+		string(APPEND files "\t{\"${name}\", {reinterpret_cast<const char*>(spirv_${index}), sizeof(spirv_${index})}},\n")
+		math(EXPR index "${index} + 1")
+	endforeach()
+
+	string(APPEND content "\nstatic const abd::embedded_file spirv_data[] =\n{\n${files}};\n\n")
+	string(APPEND content "const abd::embedded_file *const abd::embedded_spirv = spirv_data;\n")
+	string(APPEND content "const std::size_t abd::embedded_spirv_count = sizeof(spirv_data) / sizeof(spirv_data[0]);\n")
+else()
+	string(APPEND content "const abd::embedded_file *const abd::embedded_spirv = nullptr;\n")
+	string(APPEND content "const std::size_t abd::embedded_spirv_count = 0;\n")
+endif()
+
+file(WRITE "${OUTPUT}" "${content}")
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <albedo/mesh.hpp>
+#include <albedo/mapped_file.hpp>
+#include <boost/filesystem.hpp>
+#include <memory>
+#include <vector>
+
+/**
+	\file Baked meshes - mesh data packed offline in the GPU format (see tools/bake_mesh.cpp).
+	Loading a baked mesh requires no parsing or processing of the vertex data.
+*/
+
+namespace abd {
+
+/**
+	Packs the mesh with given vertex layout and writes it to a file.
+	The file contains the sub-mesh table (draws, LODs, meshlets, materials)
+	followed by vertex and index data exactly as it's stored in the buffers.
+
+	\note Textures referenced by materials are not baked. The format is not
+	portable between machines with different endianness.
+*/
+void bake_mesh(const boost::filesystem::path &path, const mesh_data &data, vertex_layout layout = vertex_layout::SEPARATE);
+
+/**
+	A memory-mapped baked mesh file. Vertex and index data can be
+	passed to the GL directly from the mapping (see mesh_buffers).
+
+	The file is validated when it's opened - sizes of the vertex streams,
+	index and vertex ranges of all draws and meshlet ranges are checked,
+	so a damaged file is rejected with abd::exception.
+*/
+class baked_mesh
+{
+public:
+	//! Data in the mapped file
+	struct blob
+	{
+		const void *data;
+		GLsizeiptr size;
+	};
+
+	explicit baked_mesh(const boost::filesystem::path &path);
+
+	const packed_mesh_info &get_info() const
+	{
+		return m_info;
+	}
+
+	//! Vertex streams (empty ones have zero size)
+	const std::vector<blob> &get_vertex_streams() const
+	{
+		return m_vertex_streams;
+	}
+
+	blob get_indices() const
+	{
+		return m_indices;
+	}
+
+	const std::vector<std::vector<meshlet>> &get_meshlets() const
+	{
+		return m_table.meshlets;
+	}
+
+	std::size_t get_sub_mesh_count() const
+	{
+		return m_table.draw_sizes.size();
+	}
+
+	/**
+		Returns the sub-mesh table - mesh data without vertices and indices.
+		Base indices are given as if the LODs were read back (see mesh_buffers::read_back()).
+	*/
+	const mesh_data &get_table() const
+	{
+		return m_table;
+	}
+
+private:
+	mapped_file m_file;
+	packed_mesh_info m_info;
+	std::vector<blob> m_vertex_streams;
+	blob m_indices;
+	mesh_data m_table;
+};
+
+/**
+	Maps a baked mesh file and uploads the data straight from the mapping.
+	The resulting mesh keeps only the sub-mesh table in system memory.
+*/
+std::shared_ptr<mesh> load_baked_mesh(const boost::filesystem::path &path);
+
+}
@@ -3,6 +3,7 @@
 #include <albedo/gl/gl.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <array>
 
 namespace abd {
 
@@ -97,4 +98,16 @@ private:
 	glm::vec3 m_up;
 };
 
+/**
+	View frustum planes extracted from a view-projection matrix.
+	Plane normals point inwards.
+*/
+struct frustum
+{
+	std::array<glm::vec4, 6> planes;
+
+	static frustum from_matrix(const glm::mat4 &m);
+	bool intersects_sphere(const glm::vec3 &center, float radius) const;
+};
+
 } // namespace abd
\ No newline at end of file
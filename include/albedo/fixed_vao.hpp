@@ -1,15 +1,46 @@
 #pragma once
 
 #include <albedo/gl/vertex_array.hpp>
+#include <albedo/vertex_format.hpp>
 #include <optional>
+#include <cstddef>
+#include <vector>
 
 namespace abd {
 
 /**
-	List of optional attribute configurations
+	Determines how vertex attributes are laid out in GPU buffers
+*/
+enum class vertex_layout
+{
+	SEPARATE,     //!< Positions, normals and UVs in separate buffers (see standard_vao_layout)
+	INTERLEAVED,  //!< One buffer of interleaved_vertex structures (see interleaved_vao_layout)
+	COMPACT,      //!< One buffer of compact_vertex structures (see compact_vao_layout)
+};
+
+//! Whether positions in the layout need dequantization (see vertex_quantization)
+constexpr bool has_quantized_positions(vertex_layout layout)
+{
+	return layout == vertex_layout::COMPACT;
+}
+
+/**
+	Returns strides of vertex buffers used by the layout. Buffer
+	with index i is always bound at VAO binding i.
+*/
+const std::vector<GLsizei> &get_vertex_layout_strides(vertex_layout layout);
+
+/**
+	List of optional attribute configurations.
+	Attribute indices (shader input locations) are fixed, so
+	multiple attributes can share one buffer binding.
 */
 struct vao_layout
 {
+	static constexpr GLuint position_index = 0;
+	static constexpr GLuint normal_index = 1;
+	static constexpr GLuint uv_index = 2;
+
 	std::optional<gl::vao_attribute_config> attrib_positions;
 	std::optional<gl::vao_attribute_config> attrib_normals;
 	std::optional<gl::vao_attribute_config> attrib_uvs;
@@ -50,5 +81,44 @@ inline const vao_layout standard_vao_layout =
 	.attrib_uvs = {{2, 2, GL_FLOAT, GL_FALSE, 0}},
 };
 
+using interleaved_vertex = interleaved_vertex_format::vertex;
+using compact_vertex = compact_vertex_format::vertex;
+
+/**
+	Creates VAO layout for an interleaved vertex_format
+*/
+template <typename Format>
+vao_layout make_vao_layout()
+{
+	return {
+		.attrib_positions = Format::position_config(),
+		.attrib_normals = Format::normal_config(),
+		.attrib_uvs = Format::uv_config(),
+	};
+}
+
+/**
+	Interleaved VAO layout. Requires one buffer containing
+	interleaved_vertex structures at binding 0.
+		- attr 0 - vec3 positions
+		- attr 1 - vec3 normals
+		- attr 2 - vec2 uvs
+*/
+inline const vao_layout interleaved_vao_layout = make_vao_layout<interleaved_vertex_format>();
+
+/**
+	Compressed VAO layout. Requires one buffer containing
+	compact_vertex structures at binding 0.
+		- attr 0 - snorm16 positions (dequantized in the shader)
+		- attr 1 - 10:10:10:2 snorm normals
+		- attr 2 - half-float uvs
+*/
+inline const vao_layout compact_vao_layout = make_vao_layout<compact_vertex_format>();
+
+/**
+	Returns VAO layout matching the vertex layout
+*/
+const vao_layout &get_vao_layout(vertex_layout layout);
+
 
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <albedo/gl/gl.hpp>
+#include <vector>
+
+namespace abd::gl {
+
+/**
+	Textures, samplers, UBO and SSBO ranges recorded once and bound
+	together with the multi-bind functions - a single call per resource type.
+
+	Each resource type covers a contiguous range of binding points - from
+	the lowest to the highest one set. Binding points within the range which
+	haven't been set are reset to 0 on bind().
+*/
+class binding_set
+{
+public:
+	void set_texture(GLuint unit, GLuint texture);
+	void set_sampler(GLuint unit, GLuint sampler);
+	void set_uniform_buffer(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	void set_storage_buffer(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+	void bind() const;
+
+private:
+	//! Names bound to a contiguous range of binding points
+	struct name_range
+	{
+		GLuint first = 0;
+		std::vector<GLuint> names;
+
+		void set(GLuint index, GLuint name);
+	};
+
+	//! Buffer ranges bound to a contiguous range of binding points
+	struct buffer_range
+	{
+		name_range buffers;
+		std::vector<GLintptr> offsets;
+		std::vector<GLsizeiptr> sizes;
+
+		void set(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+		void bind(GLenum target) const;
+	};
+
+	name_range m_textures;
+	name_range m_samplers;
+	buffer_range m_uniform_buffers;
+	buffer_range m_storage_buffers;
+};
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <albedo/gl/gl.hpp>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+/**
+	\file Compile-time checks of C++ structs mirroring GLSL structs in
+	std140/std430 buffer blocks, and link-time checks against program reflection.
+
+	The layout of a struct is described by types of its fields and their
+	offsets (from offsetof()):
+
+		static_assert(abd::gl::check_buffer_layout<abd::gl::buffer_layout::STD140, data, GLint, glm::vec4>({
+			offsetof(data, a),
+			offsetof(data, b),
+		}));
+
+	The check fails if any field isn't where the GLSL rules place it, if its
+	size differs from the GLSL size (e.g. glm::mat3) or if size of the struct
+	doesn't match its array stride. Supported field types are int, uint, float,
+	their vectors, float matrices and arrays of them. Fields following
+	a vector or an array usually need alignas() to match.
+*/
+
+namespace abd::gl {
+
+enum class buffer_layout
+{
+	STD140,
+	STD430,
+};
+
+/**
+	Base alignment and size of a GLSL type (in bytes) in the given layout
+*/
+template <buffer_layout Layout, typename T>
+struct glsl_type_layout;
+
+//! Base alignment and size of a scalar or vector with N components
+template <int N>
+struct glsl_vector_layout
+{
+	static constexpr std::size_t alignment = (N == 3 ? 4 : N) * 4;
+	static constexpr std::size_t size = N * 4;
+};
+
+template <buffer_layout L> struct glsl_type_layout<L, GLint> : glsl_vector_layout<1> {};
+template <buffer_layout L> struct glsl_type_layout<L, GLuint> : glsl_vector_layout<1> {};
+template <buffer_layout L> struct glsl_type_layout<L, GLfloat> : glsl_vector_layout<1> {};
+template <buffer_layout L> struct glsl_type_layout<L, glm::vec2> : glsl_vector_layout<2> {};
+template <buffer_layout L> struct glsl_type_layout<L, glm::vec3> : glsl_vector_layout<3> {};
+template <buffer_layout L> struct glsl_type_layout<L, glm::vec4> : glsl_vector_layout<4> {};
+template <buffer_layout L> struct glsl_type_layout<L, glm::ivec2> : glsl_vector_layout<2> {};
+template <buffer_layout L> struct glsl_type_layout<L, glm::ivec3> : glsl_vector_layout<3> {};
+template <buffer_layout L> struct glsl_type_layout<L, glm::ivec4> : glsl_vector_layout<4> {};
+template <buffer_layout L> struct glsl_type_layout<L, glm::uvec2> : glsl_vector_layout<2> {};
+template <buffer_layout L> struct glsl_type_layout<L, glm::uvec3> : glsl_vector_layout<3> {};
+template <buffer_layout L> struct glsl_type_layout<L, glm::uvec4> : glsl_vector_layout<4> {};
+
+/**
+	Arrays - the stride is the element size rounded up to element alignment.
+	std140 additionally rounds the alignment (and so the stride) up to vec4.
+*/
+template <buffer_layout L, typename T, std::size_t N>
+struct glsl_type_layout<L, T[N]>
+{
+	static constexpr std::size_t element_alignment = glsl_type_layout<L, T>::alignment;
+	static constexpr std::size_t alignment = L == buffer_layout::STD140 && element_alignment < 16 ? 16 : element_alignment;
+	static constexpr std::size_t stride = (glsl_type_layout<L, T>::size + alignment - 1) / alignment * alignment;
+	static constexpr std::size_t size = N * stride;
+};
+
+//! Column-major matrices are laid out as arrays of column vectors
+template <buffer_layout L> struct glsl_type_layout<L, glm::mat2> : glsl_type_layout<L, glm::vec2[2]> {};
+template <buffer_layout L> struct glsl_type_layout<L, glm::mat3> : glsl_type_layout<L, glm::vec3[3]> {};
+template <buffer_layout L> struct glsl_type_layout<L, glm::mat4> : glsl_type_layout<L, glm::vec4[4]> {};
+
+/**
+	Returns true if the offsets of fields and size of the struct T
+	match GLSL layout of a struct with the Fields
+*/
+template <buffer_layout Layout, typename T, typename... Fields>
+constexpr bool check_buffer_layout(std::initializer_list<std::size_t> offsets)
+{
+	constexpr std::size_t alignments[] = {glsl_type_layout<Layout, Fields>::alignment...};
+	constexpr std::size_t sizes[] = {glsl_type_layout<Layout, Fields>::size...};
+	constexpr std::size_t cpp_sizes[] = {sizeof(Fields)...};
+
+	if (offsets.size() != sizeof...(Fields))
+		return false;
+
+	std::size_t offset = 0;
+	std::size_t struct_alignment = Layout == buffer_layout::STD140 ? 16 : 0;
+	std::size_t i = 0;
+	for (auto cpp_offset : offsets)
+	{
+		offset = (offset + alignments[i] - 1) / alignments[i] * alignments[i];
+		if (cpp_offset != offset || cpp_sizes[i] != sizes[i])
+			return false;
+
+		offset += sizes[i];
+		struct_alignment = alignments[i] > struct_alignment ? alignments[i] : struct_alignment;
+		i++;
+	}
+
+	// Size of the struct must be its array stride
+	return sizeof(T) == (offset + struct_alignment - 1) / struct_alignment * struct_alignment;
+}
+
+class program;
+
+/**
+	A field of a C++ struct and name of the corresponding GLSL variable
+*/
+struct buffer_field
+{
+	std::string name;
+	std::size_t offset;
+};
+
+/**
+	Checks offsets of the fields against the program's uniform reflection.
+	The names are prefixed with prefix (e.g. "BLOCK.array[0]."). Fields
+	unused by the program are skipped. Throws abd::exception on mismatch.
+*/
+void check_uniform_layout(const program &program, const std::string &prefix, const std::vector<buffer_field> &fields, std::size_t base_offset = 0);
+
+}
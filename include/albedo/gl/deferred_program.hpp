@@ -0,0 +1,48 @@
+#pragma once
+
+#include <albedo/gl/program.hpp>
+#include <albedo/gl/shader.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace abd::gl {
+
+//! Whether the driver can compile shaders on its own threads (GL_KHR_parallel_shader_compile)
+bool has_parallel_shader_compile();
+
+/**
+	Sets number of threads the driver may use for shader compilation.
+	The default allows the driver to choose. No-op without parallel compile support.
+*/
+void set_shader_compiler_threads(GLuint count = 0xffffffff);
+
+/**
+	A program whose shaders have been submitted for compilation and linking,
+	but whose status hasn't been queried yet. Querying the status forces the
+	work to finish, so it's postponed until the program is actually needed.
+
+	With GL_KHR_parallel_shader_compile the driver compiles in the background
+	and is_ready() tells when finish() won't block. Without it, the work is
+	still submitted up front, so the driver is free to overlap it.
+*/
+class deferred_program : abd::noncopy
+{
+public:
+	//! Called once the program is linked successfully (e.g. to cache its binary)
+	using link_callback = std::function<void(const program &)>;
+
+	deferred_program(std::vector<shader> &&shaders, link_callback on_link = {});
+	explicit deferred_program(program &&linked);
+
+	bool is_ready() const;
+	program finish();
+
+private:
+	std::vector<shader> m_shaders;
+	std::unique_ptr<program> m_program;
+	link_callback m_on_link;
+	bool m_linked = false;
+};
+
+}
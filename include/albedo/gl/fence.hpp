@@ -23,7 +23,7 @@ public:
 	inline void destroy();
 
 	inline bool is_signaled() const;
-	inline void wait(GLuint64 timeout = 0.1e9) const;
+	inline bool wait(GLuint64 timeout = 0.1e9) const;
 
 private:
 	mutable GLsync m_sync = nullptr;
@@ -38,7 +38,7 @@ fence_sync::fence_sync(fence_sync &&rhs) noexcept :
 fence_sync &fence_sync::operator=(fence_sync &&rhs) noexcept
 {
 	if (this != &rhs)
-		std::swap(*this, rhs);
+		std::swap(m_sync, rhs.m_sync);
 	return *this;
 }
 
@@ -76,16 +76,23 @@ bool fence_sync::is_signaled() const
 }
 
 /**
-	Waits for sync and then destroys it (since destroyed fences are equivalent to signaled)
+	Waits for sync and then destroys it (since destroyed fences are equivalent to signaled).
+	Returns false if the timeout expired - the fence is kept intact then.
 */
-void fence_sync::wait(GLuint64 timeout) const
+bool fence_sync::wait(GLuint64 timeout) const
 {
-	if (m_sync != nullptr)
-	{
-		glClientWaitSync(m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
-		glDeleteSync(m_sync);
-		m_sync = nullptr;
-	}
+	if (m_sync == nullptr)
+		return true;
+
+	GLenum result = glClientWaitSync(m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+	if (result == GL_WAIT_FAILED)
+		throw abd::exception("glClientWaitSync() failed");
+	else if (result == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	glDeleteSync(m_sync);
+	m_sync = nullptr;
+	return true;
 }
 
 };
\ No newline at end of file
@@ -2,8 +2,10 @@
 
 #include <type_traits>
 #include <string>
+#include <atomic>
 
 #include <albedo/gl/gl.hpp>
+#include <albedo/gl/state_cache.hpp>
 #include <albedo/utils.hpp>
 
 namespace abd
@@ -87,12 +89,12 @@ protected:
 	GLuint m_id;
 
 private:
-	//! Incremented on each glCreate*() call for certain object type
-	static std::uint64_t m_creation_counter;
+	//! Incremented on each glCreate*() call for certain object type (objects may be created by multiple threads with shared contexts)
+	static std::atomic<std::uint64_t> m_creation_counter;
 };
 
 template <gl_object_type T>
-std::uint64_t gl_object<T>::m_creation_counter = 0;
+std::atomic<std::uint64_t> gl_object<T>::m_creation_counter = 0;
 
 //! Move constructor with source invalidation
 template <gl_object_type T>
@@ -196,6 +198,7 @@ inline gl_object<gl_object_type::TEXTURE>::gl_object(GLenum target)
 template <>
 inline gl_object<gl_object_type::TEXTURE>::~gl_object()
 {
+	state_cache::get().forget_texture(m_id);
 	glDeleteTextures(1, &m_id);
 }
 
@@ -276,6 +279,7 @@ inline gl_object<gl_object_type::VERTEX_ARRAY>::gl_object()
 template <>
 inline gl_object<gl_object_type::VERTEX_ARRAY>::~gl_object()
 {
+	state_cache::get().forget_vertex_array(m_id);
 	glDeleteVertexArrays(1, &m_id);
 }
 
@@ -293,6 +297,7 @@ inline gl_object<gl_object_type::FRAMEBUFFER>::gl_object()
 template <>
 inline gl_object<gl_object_type::FRAMEBUFFER>::~gl_object()
 {
+	state_cache::get().forget_framebuffer(m_id);
 	glDeleteFramebuffers(1, &m_id);
 }
 
@@ -386,6 +391,7 @@ inline gl_object<gl_object_type::PROGRAM>::gl_object()
 template <>
 inline gl_object<gl_object_type::PROGRAM>::~gl_object()
 {
+	state_cache::get().forget_program(m_id);
 	glDeleteProgram(m_id);
 }
 
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <albedo/gl/gl.hpp>
+
+namespace abd::gl {
+
+/**
+	Layout of a single command read by glMultiDrawElementsIndirect()
+*/
+struct draw_elements_indirect_command
+{
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+
+static_assert(sizeof(draw_elements_indirect_command) == 5 * sizeof(GLuint), "indirect commands must be tightly packed");
+
+}
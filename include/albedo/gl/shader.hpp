@@ -4,7 +4,9 @@
 #include <albedo/gl/gl_object.hpp>
 #include <albedo/utils.hpp>
 #include <albedo/exception.hpp>
+#include <cstddef>
 #include <string>
+#include <vector>
 
 namespace abd {
 namespace gl{
@@ -47,6 +49,26 @@ shader_exception::shader_exception(T &&link_log, program_link_error) :
 {
 }
 
+/**
+	Tag for creating shaders without waiting for the compilation result
+	(see deferred_program)
+*/
+struct deferred_compile_t {};
+inline constexpr deferred_compile_t deferred_compile{};
+
+//! Whether SPIR-V shaders can be used (OpenGL 4.6 or GL_ARB_gl_spirv)
+bool has_spirv_support();
+
+/**
+	Value of a SPIR-V specialization constant. The value holds
+	bits of the constant (int, uint, float or bool).
+*/
+struct specialization_constant
+{
+	GLuint id;
+	GLuint value;
+};
+
 /**
 	A wrapper for OpenGL shader object.
 */
@@ -55,7 +77,13 @@ class shader : public abd::gl::gl_object<abd::gl::gl_object_type::SHADER>
 public:
 	shader(GLenum shader_type, const char *src);
 	shader(GLenum shader_type, const std::string &src);
+	shader(GLenum shader_type, const char *src, deferred_compile_t);
+	shader(GLenum shader_type, const std::string &src, deferred_compile_t);
+
+	shader(GLenum shader_type, const void *spirv, std::size_t size, const std::vector<specialization_constant> &constants = {});
+	shader(GLenum shader_type, const void *spirv, std::size_t size, const std::vector<specialization_constant> &constants, deferred_compile_t);
 
+	void check_compile_status() const;
 	std::string get_compile_log() const;
 };
 
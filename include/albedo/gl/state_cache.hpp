@@ -0,0 +1,103 @@
+#pragma once
+
+#include <albedo/gl/gl.hpp>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace abd::gl {
+
+/**
+	Numbers of state changing calls passed to the state_cache
+	and of those dropped, because they wouldn't change anything
+*/
+struct state_cache_stats
+{
+	std::uint64_t calls = 0;
+	std::uint64_t filtered = 0;
+};
+
+/**
+	Shadow copy of the GL state changed most often - enabled capabilities,
+	depth and blending state, bound framebuffers, program, VAO and textures.
+	Calls which wouldn't change the state are dropped.
+
+	The cache belongs to the thread (GL context) it's used on. Unknown state
+	is always set. If the state is changed bypassing the cache (e.g. by
+	other libraries), invalidate() has to be called.
+*/
+class state_cache
+{
+public:
+	static state_cache &get();
+
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void depth_mask(GLboolean flag);
+	void depth_func(GLenum func);
+	void blend_func(GLenum sfactor, GLenum dfactor);
+	void blend_equation(GLenum mode);
+
+	void bind_framebuffer(GLenum target, GLuint framebuffer);
+	void use_program(GLuint program);
+	void bind_vertex_array(GLuint vertex_array);
+	void bind_texture_unit(GLuint unit, GLuint texture);
+	void bind_textures(GLuint first, GLsizei count, const GLuint *textures);
+
+	// Called when objects are deleted, because their names can be reused
+	void forget_framebuffer(GLuint framebuffer);
+	void forget_program(GLuint program);
+	void forget_vertex_array(GLuint vertex_array);
+	void forget_texture(GLuint texture);
+
+	void invalidate();
+
+	const state_cache_stats &get_stats() const
+	{
+		return m_stats;
+	}
+
+	void reset_stats()
+	{
+		m_stats = {};
+	}
+
+private:
+	template <typename T>
+	bool update(std::optional<T> &cached, const T &value);
+
+	std::map<GLenum, bool> m_capabilities;
+	std::optional<GLboolean> m_depth_mask;
+	std::optional<GLenum> m_depth_func;
+	std::optional<std::pair<GLenum, GLenum>> m_blend_func;
+	std::optional<GLenum> m_blend_equation;
+
+	std::optional<GLuint> m_draw_framebuffer;
+	std::optional<GLuint> m_read_framebuffer;
+	std::optional<GLuint> m_program;
+	std::optional<GLuint> m_vertex_array;
+	std::vector<std::optional<GLuint>> m_texture_units;
+
+	state_cache_stats m_stats;
+};
+
+/**
+	Returns true (and updates the cached value) if the value changes the state
+*/
+template <typename T>
+bool state_cache::update(std::optional<T> &cached, const T &value)
+{
+	m_stats.calls++;
+	if (cached && *cached == value)
+	{
+		m_stats.filtered++;
+		return false;
+	}
+
+	cached = value;
+	return true;
+}
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <albedo/gl/synced_buffer.hpp>
+#include <cstddef>
+#include <optional>
+
+namespace abd::gl {
+
+/**
+	Typed view of an array in mapped buffer memory, so the elements
+	are written directly to memory visible to the GPU. The view doesn't
+	own the memory.
+*/
+template <typename T>
+class mapped_array
+{
+public:
+	mapped_array(T *data, std::size_t size) :
+		m_data(data),
+		m_size(size)
+	{
+	}
+
+	T &operator[](std::size_t index) const
+	{
+		return m_data[index];
+	}
+
+	T *data() const {return m_data;}
+	std::size_t size() const {return m_size;}
+	T *begin() const {return m_data;}
+	T *end() const {return m_data + m_size;}
+
+private:
+	T *m_data;
+	std::size_t m_size;
+};
+
+/**
+	Describes a region sub-allocated from a stream_buffer.
+	The region is only valid until the end of the frame it was allocated in.
+*/
+struct stream_allocation
+{
+	//! Pointer to the mapped memory
+	void *ptr;
+
+	//! Offset relative to the beginning of the buffer
+	GLintptr offset;
+
+	//! Size of the region in bytes
+	GLsizeiptr size;
+
+	//! The buffer the region belongs to
+	gl::buffer *buffer;
+
+	template <typename T>
+	T *get_ptr() const
+	{
+		return static_cast<T*>(ptr);
+	}
+
+	//! The region as an array of as many elements as fit in it
+	template <typename T>
+	mapped_array<T> get_array() const
+	{
+		return {get_ptr<T>(), static_cast<std::size_t>(size) / sizeof(T)};
+	}
+};
+
+/**
+	A linear per-frame allocator built on top of a persistently mapped synced_buffer.
+	Each frame gets its own synced_buffer chunk, from which arbitrarily sized
+	and correctly aligned regions can be allocated. At the end of the frame,
+	used memory is flushed and fenced, so the chunk is recycled only once
+	the GPU is done with it.
+
+	The mapping is not coherent, so flush() has to be called after writing
+	and before issuing any commands reading the data.
+
+	This is meant to replace glNamedBufferSubData() calls for all transient
+	data - transforms, materials, indirect commands, dynamic vertices, etc.
+*/
+class stream_buffer
+{
+public:
+	explicit stream_buffer(GLsizeiptr frame_size, int frame_count = 3);
+
+	void begin_frame();
+	bool try_begin_frame();
+	void flush();
+	void flush(const stream_allocation &allocation);
+	void end_frame();
+	inline bool is_frame_active() const;
+
+	stream_allocation allocate(GLsizeiptr size, GLsizeiptr alignment);
+	stream_allocation allocate_uniform(GLsizeiptr size);
+	stream_allocation allocate_storage(GLsizeiptr size);
+
+	template <typename T>
+	inline stream_allocation allocate_array(std::size_t count);
+
+	inline GLsizeiptr get_frame_size() const;
+	inline GLsizeiptr get_used_size() const;
+	inline gl::synced_buffer &get_synced_buffer();
+
+	static GLsizeiptr get_uniform_alignment();
+	static GLsizeiptr get_storage_alignment();
+
+private:
+	static GLsizeiptr align_frame_size(GLsizeiptr size);
+
+	gl::synced_buffer m_synced_buffer;
+	std::optional<gl::synced_buffer_handle> m_chunk;
+	GLsizeiptr m_used = 0;
+	GLsizeiptr m_flushed = 0;
+};
+
+bool stream_buffer::is_frame_active() const
+{
+	return m_chunk.has_value();
+}
+
+/**
+	Allocates an array of objects of type T (only aligned to the
+	type's alignment requirement)
+*/
+template <typename T>
+stream_allocation stream_buffer::allocate_array(std::size_t count)
+{
+	return allocate(count * sizeof(T), alignof(T));
+}
+
+GLsizeiptr stream_buffer::get_frame_size() const
+{
+	return m_synced_buffer.get_chunk_size();
+}
+
+/**
+	Returns number of bytes allocated in the current frame (including padding)
+*/
+GLsizeiptr stream_buffer::get_used_size() const
+{
+	return m_used;
+}
+
+gl::synced_buffer &stream_buffer::get_synced_buffer()
+{
+	return m_synced_buffer;
+}
+
+}
@@ -2,15 +2,49 @@
 
 #include <albedo/gl/fence.hpp>
 #include <albedo/gl/buffer.hpp>
+#include <optional>
+#include <chrono>
+#include <cstdint>
 
 namespace abd::gl {
 
 class synced_buffer_handle;
 
+/**
+	Chunk acquisition statistics. Allow tuning the number of
+	frames in flight based on measured data.
+*/
+struct synced_buffer_stats
+{
+	//! Number of chunks handed out
+	std::uint64_t acquisitions = 0;
+
+	//! Number of acquisitions that found the chunk still in use by the GPU
+	std::uint64_t stalls = 0;
+
+	//! Number of failed try_get_chunk() calls
+	std::uint64_t failed_acquisitions = 0;
+
+	//! Number of fence wait timeouts
+	std::uint64_t timeouts = 0;
+
+	//! Number of chunks added by automatic growth
+	std::uint64_t grows = 0;
+
+	//! Total and longest time spent blocked on fences
+	std::chrono::nanoseconds total_wait_time{0};
+	std::chrono::nanoseconds max_wait_time{0};
+};
+
 /**
 	Upon request, returns handles to buffer chunks that
 	are guaranteed not to be in use by the GPU.
 
+	Chunks are handed out in round-robin fashion. If automatic growth
+	is enabled, a busy chunk causes a new one to be inserted into
+	the ring instead of blocking. New chunks live in separate buffer
+	objects, so handles to existing chunks remain valid.
+
 	This class is optimized for writing the mapped memory.
 */
 class synced_buffer
@@ -26,31 +60,68 @@ public:
 	synced_buffer &operator=(synced_buffer &&) = default;
 
 	synced_buffer_handle get_chunk();
+	std::optional<synced_buffer_handle> try_get_chunk();
 	inline GLsizeiptr get_chunk_size() const;
 	inline int get_chunk_count() const;
 
+	inline void set_auto_grow(int max_chunk_count);
+	inline void set_wait_timeout(GLuint64 timeout);
+
+	inline const synced_buffer_stats &get_stats() const;
+	inline void reset_stats();
+
 	inline gl::fence_sync &get_fence(int index = 0);
 	inline gl::buffer &get_buffer(int index = 0);
 	inline void *get_map_ptr(int index = 0);
+	inline GLintptr get_chunk_offset(int index) const;
 
 private:
+	/**
+		A persistently mapped buffer containing one or more chunks
+	*/
+	struct segment
+	{
+		gl::buffer buffer;
+		void *map_ptr;
+	};
+
+	/**
+		A chunk within one of the segments
+	*/
+	struct chunk
+	{
+		int segment;
+		GLintptr offset;
+		gl::fence_sync fence;
+	};
+
+	void add_segment(int chunk_count);
+	synced_buffer_handle take_current_chunk();
+	bool grow();
+
 	GLsizeiptr m_chunk_size;
-	int m_chunk_count;
-	int m_current_chunk = 0;
+	GLbitfield m_flags;
+	int m_max_chunk_count = 0;
+	GLuint64 m_wait_timeout = 0.1e9;
 
-	gl::buffer m_buffer;
-	std::vector<gl::fence_sync> m_fences;
-	void* m_map_ptr = nullptr;
+	std::vector<segment> m_segments;
+	std::vector<chunk> m_chunks;
+
+	//! Order in which chunks are handed out and current position in it
+	std::vector<int> m_ring;
+	int m_ring_position = 0;
+
+	synced_buffer_stats m_stats;
 };
 
 gl::buffer &synced_buffer::get_buffer(int index)
 {
-	return m_buffer;
+	return m_segments.at(m_chunks.at(index).segment).buffer;
 }
 
 gl::fence_sync &synced_buffer::get_fence(int index)
 {
-	return m_fences.at(index);
+	return m_chunks.at(index).fence;
 }
 
 GLsizeiptr synced_buffer::get_chunk_size() const
@@ -60,15 +131,52 @@ GLsizeiptr synced_buffer::get_chunk_size() const
 
 int synced_buffer::get_chunk_count() const
 {
-	return m_chunk_count;
+	return m_chunks.size();
 }
 
 /**
-	Returns a pointer to mapped buffer memory
+	Enables automatic growth of the chunk ring up to max_chunk_count chunks.
+	Passing 0 disables it.
+*/
+void synced_buffer::set_auto_grow(int max_chunk_count)
+{
+	m_max_chunk_count = max_chunk_count;
+}
+
+/**
+	Sets timeout (in nanoseconds) of a single fence wait. Timeouts are
+	only counted - get_chunk() keeps waiting until the chunk is free.
+*/
+void synced_buffer::set_wait_timeout(GLuint64 timeout)
+{
+	m_wait_timeout = timeout;
+}
+
+const abd::gl::synced_buffer_stats &synced_buffer::get_stats() const
+{
+	return m_stats;
+}
+
+void synced_buffer::reset_stats()
+{
+	m_stats = synced_buffer_stats{};
+}
+
+/**
+	Returns a pointer to mapped buffer memory (the base pointer
+	of the buffer containing the chunk)
 */
 void *synced_buffer::get_map_ptr(int index)
 {
-	return m_map_ptr;
+	return m_segments.at(m_chunks.at(index).segment).map_ptr;
+}
+
+/**
+	Returns chunk offset relative to the beginning of the buffer containing it
+*/
+GLintptr synced_buffer::get_chunk_offset(int index) const
+{
+	return m_chunks.at(index).offset;
 }
 
 /**
@@ -92,6 +200,7 @@ public:
 	inline gl::buffer &get_buffer();
 
 	inline void flush();
+	inline void flush(GLintptr offset, GLsizeiptr size);
 	inline void fence();
 
 private:
@@ -118,7 +227,7 @@ GLsizeiptr synced_buffer_handle::get_size() const
 */
 GLsizeiptr synced_buffer_handle::get_offset() const
 {
-	return get_size() * m_index;
+	return m_synced_buffer->get_chunk_offset(m_index);
 }
 
 /**
@@ -134,7 +243,7 @@ int synced_buffer_handle::get_index() const
 */
 void *synced_buffer_handle::get_ptr()
 {
-	return static_cast<char*>(m_synced_buffer->get_map_ptr()) + get_offset();
+	return static_cast<char*>(m_synced_buffer->get_map_ptr(m_index)) + get_offset();
 }
 
 gl::synced_buffer &synced_buffer_handle::get_synced_buffer()
@@ -164,9 +273,18 @@ void synced_buffer_handle::flush()
 	glFlushMappedNamedBufferRange(get_buffer(), get_offset(), get_size());
 }
 
+/**
+	Flushes only a part of the chunk. Offset is relative to
+	the beginning of the chunk.
+*/
+void synced_buffer_handle::flush(GLintptr offset, GLsizeiptr size)
+{
+	glFlushMappedNamedBufferRange(get_buffer(), get_offset() + offset, size);
+}
+
 void synced_buffer_handle::fence()
 {
 	get_fence().fence();
 }
 
-}
\ No newline at end of file
+}
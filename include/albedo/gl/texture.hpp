@@ -1,6 +1,7 @@
 #pragma once 
 
 #include <albedo/gl/gl_object.hpp>
+#include <albedo/gl/state_cache.hpp>
 #include <albedo/gl/buffer.hpp>
 
 namespace abd::gl {
@@ -117,7 +118,7 @@ texture<Ttarget>::texture() :
 template <texture_target Ttarget>
 void texture<Ttarget>::bind_texture(int unit)
 {
-	glBindTextureUnit(unit, *this);
+	state_cache::get().bind_texture_unit(unit, *this);
 }
 
 /**
@@ -29,14 +29,26 @@ public:
 
 	inline operator GLint() const;
 
-	uniform &operator=(GLfloat f) {glProgramUniform1f(m_program, m_location, f); return *this;}
-	uniform &operator=(GLint i) {glProgramUniform1i(m_program, m_location, i); return *this;}
-	uniform &operator=(const glm::vec2 &v) {glProgramUniform2fv(m_program, m_location, 1, &v[0]); return *this;}
-	uniform &operator=(const glm::vec3 &v) {glProgramUniform3fv(m_program, m_location, 1, &v[0]); return *this;}
-	uniform &operator=(const glm::vec4 &v) {glProgramUniform4fv(m_program, m_location, 1, &v[0]); return *this;}
-	uniform &operator=(const glm::mat2 &m) {glProgramUniformMatrix2fv(m_program, m_location, 1, GL_FALSE, &m[0][0]); return *this;}
-	uniform &operator=(const glm::mat3 &m) {glProgramUniformMatrix3fv(m_program, m_location, 1, GL_FALSE, &m[0][0]); return *this;}
-	uniform &operator=(const glm::mat4 &m) {glProgramUniformMatrix4fv(m_program, m_location, 1, GL_FALSE, &m[0][0]); return *this;}
+	inline GLuint get_program() const;
+
+	uniform &operator=(GLfloat f) {upload(m_program, m_location, f); return *this;}
+	uniform &operator=(GLint i) {upload(m_program, m_location, i); return *this;}
+	uniform &operator=(const glm::vec2 &v) {upload(m_program, m_location, v); return *this;}
+	uniform &operator=(const glm::vec3 &v) {upload(m_program, m_location, v); return *this;}
+	uniform &operator=(const glm::vec4 &v) {upload(m_program, m_location, v); return *this;}
+	uniform &operator=(const glm::mat2 &m) {upload(m_program, m_location, m); return *this;}
+	uniform &operator=(const glm::mat3 &m) {upload(m_program, m_location, m); return *this;}
+	uniform &operator=(const glm::mat4 &m) {upload(m_program, m_location, m); return *this;}
+
+	// Sets value of the uniform at location in the program
+	static void upload(GLuint program, GLint location, GLfloat f) {glProgramUniform1f(program, location, f);}
+	static void upload(GLuint program, GLint location, GLint i) {glProgramUniform1i(program, location, i);}
+	static void upload(GLuint program, GLint location, const glm::vec2 &v) {glProgramUniform2fv(program, location, 1, &v[0]);}
+	static void upload(GLuint program, GLint location, const glm::vec3 &v) {glProgramUniform3fv(program, location, 1, &v[0]);}
+	static void upload(GLuint program, GLint location, const glm::vec4 &v) {glProgramUniform4fv(program, location, 1, &v[0]);}
+	static void upload(GLuint program, GLint location, const glm::mat2 &m) {glProgramUniformMatrix2fv(program, location, 1, GL_FALSE, &m[0][0]);}
+	static void upload(GLuint program, GLint location, const glm::mat3 &m) {glProgramUniformMatrix3fv(program, location, 1, GL_FALSE, &m[0][0]);}
+	static void upload(GLuint program, GLint location, const glm::mat4 &m) {glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, &m[0][0]);}
 
 private:
 	uniform(
@@ -72,6 +84,14 @@ GLuint uniform::get_location() const
 	return m_location;
 }
 
+/**
+    Returns the program the uniform belongs to
+*/
+GLuint uniform::get_program() const
+{
+	return m_program;
+}
+
 /**
     Returns offset of an array/matrix field
 */
@@ -91,6 +111,55 @@ uniform::operator GLint() const
 	return get_location();
 }
 
+/**
+	Typed handle to a uniform, resolved once (see program::get_uniform_handle()).
+	Keeps a copy of the last uploaded value and skips glProgramUniform*() calls
+	which wouldn't change it. Setting a handle of an inactive uniform is a no-op.
+
+	\warning The copy is only valid if the uniform is set through this handle
+	only - otherwise invalidate() has to be called.
+*/
+template <typename T>
+class uniform_handle
+{
+public:
+	uniform_handle() = default;
+
+	explicit uniform_handle(const uniform &u) :
+		m_program(u.get_program()),
+		m_location(static_cast<GLint>(u.get_location()))
+	{
+	}
+
+	uniform_handle &operator=(const T &value)
+	{
+		if (m_location < 0 || (m_uploaded && m_value == value))
+			return *this;
+
+		uniform::upload(m_program, m_location, value);
+		m_value = value;
+		m_uploaded = true;
+		return *this;
+	}
+
+	//! Whether the uniform is used by the program
+	bool is_active() const
+	{
+		return m_location >= 0;
+	}
+
+	//! Forces the next assignment to upload the value
+	void invalidate()
+	{
+		m_uploaded = false;
+	}
+
+private:
+	GLuint m_program = 0;
+	GLint m_location = -1;
+	T m_value{};
+	bool m_uploaded = false;
+};
 
 /**
     Represents an OpenGL program uniform block
@@ -200,6 +200,12 @@ public:
 		return *this;
 	}
 
+	window_builder &visible(bool enable)
+	{
+		m_visible = enable;
+		return *this;
+	}
+
 	window_builder &monitor(GLFWmonitor *mon)
 	{
 		m_monitor = mon;
@@ -230,6 +236,7 @@ private:
 	bool m_forward_compat = true;
 	bool m_debug = false;
 	int m_samples = 0;
+	bool m_visible = true;
 	int m_profile = GLFW_OPENGL_CORE_PROFILE;
 	GLFWmonitor *m_monitor = nullptr;
 	GLFWwindow *m_parent = nullptr;
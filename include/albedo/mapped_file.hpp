@@ -0,0 +1,48 @@
+#pragma once
+
+#include <albedo/utils.hpp>
+#include <boost/filesystem.hpp>
+#include <cstddef>
+#include <utility>
+
+namespace abd {
+
+/**
+	A read-only, memory-mapped file. The pages are loaded by the OS on first
+	access, so the contents can be passed to the GL without reading the file first.
+*/
+class mapped_file : noncopy
+{
+public:
+	explicit mapped_file(const boost::filesystem::path &path);
+	~mapped_file();
+
+	mapped_file(mapped_file &&rhs) noexcept :
+		m_data(std::exchange(rhs.m_data, nullptr)),
+		m_size(std::exchange(rhs.m_size, 0))
+	{
+	}
+
+	mapped_file &operator=(mapped_file &&rhs) noexcept
+	{
+		std::swap(m_data, rhs.m_data);
+		std::swap(m_size, rhs.m_size);
+		return *this;
+	}
+
+	const std::byte *data() const
+	{
+		return m_data;
+	}
+
+	std::size_t size() const
+	{
+		return m_size;
+	}
+
+private:
+	std::byte *m_data = nullptr;
+	std::size_t m_size = 0;
+};
+
+}
@@ -19,6 +19,9 @@ struct material_data
 	float specular;
 	float roughness;
 	float specular_tint;
+
+	//! Back faces are drawn too. Otherwise they're culled (including whole meshlets).
+	bool two_sided = true;
 };
 
 /**
@@ -6,10 +6,35 @@
 #include <albedo/gl/vertex_array.hpp>
 #include <albedo/material.hpp>
 #include <albedo/fixed_vao.hpp>
+#include <albedo/mesh_arena.hpp>
+#include <albedo/meshlet.hpp>
+#include <functional>
+#include <optional>
 #include <vector>
 
 namespace abd {
 
+/**
+	A simplified version of a sub-mesh. Indices are stored in the same
+	index vector and refer to the same vertices as the original sub-mesh.
+*/
+struct mesh_lod
+{
+	GLint base_index;
+	GLint draw_size;
+	float error;       //!< Geometric error (in object space units)
+};
+
+/**
+	A sphere enclosing all vertices of a mesh
+*/
+struct bounding_sphere
+{
+	glm::vec3 center{0.f};
+	float radius = 0.f;
+
+	static bounding_sphere from_positions(const std::vector<glm::vec3> &positions);
+};
 
 /**
 	Represents any (simple or compound) mesh data.
@@ -21,37 +46,231 @@ namespace abd {
 struct mesh_data
 {
 	std::vector<GLint> base_indices;
+	std::vector<GLint> base_vertices;
 	std::vector<GLint> draw_sizes;
 	std::vector<std::shared_ptr<material>> materials;
 
+	//! Simplified versions of each sub-mesh (from the most detailed one). Empty if not available.
+	std::vector<std::vector<mesh_lod>> lods;
+
+	//! Clusters of each sub-mesh (full detail only). Empty if not available.
+	std::vector<std::vector<meshlet>> meshlets;
+
 	std::vector<GLuint> indices;
 	std::vector<glm::vec3> positions;
 	std::vector<glm::vec3> normals;
 	std::vector<glm::vec2> uvs;
 };
 
+/**
+	Parameters of a glDrawElementsBaseVertex() call drawing one sub-mesh
+*/
+struct sub_mesh_draw
+{
+	GLsizei count;          //!< Number of indices
+	GLenum index_type;      //!< Type of indices
+	GLintptr index_offset;  //!< Offset of the first index in the index buffer (in bytes)
+	GLint base_vertex;      //!< Value added to all indices
+};
+
+/**
+	Describes vertex and index data packed in the format used by mesh_buffers.
+	Draw parameters are relative to the beginning of the data.
+*/
+struct packed_mesh_info
+{
+	vertex_layout layout;
+	vertex_quantization quantization;
+	GLsizeiptr vertex_count;
+	bool has_uvs;
+	bounding_sphere bounds;
+
+	//! Draws of all sub-meshes at every LOD
+	std::vector<std::vector<sub_mesh_draw>> draws;
+
+	//! Maximum geometric error at every LOD
+	std::vector<float> lod_errors;
+};
+
+/**
+	Vertex and index data ready to be copied to the GPU.
+	Vertex stream i is meant to be bound at VAO binding i.
+*/
+struct packed_mesh
+{
+	packed_mesh_info info;
+	std::vector<std::vector<std::byte>> vertex_streams;
+	std::vector<std::byte> indices;
+};
+
+packed_mesh pack_mesh(const mesh_data &data, vertex_layout layout);
+
+class baked_mesh;
+
+/**
+	Creates a GPU buffer from provided data. Allows mesh_buffers to upload
+	the data in different ways (e.g. through staging buffers).
+*/
+using buffer_upload_func = std::function<std::unique_ptr<gl::buffer>(const void *data, GLsizeiptr size, GLbitfield flags)>;
+
+/**
+	Tag for creating mesh_buffers without uploading the data. The data is
+	then uploaded progressively with mesh_buffers::stream() (see mesh_streamer).
+*/
+struct deferred_upload_t {};
+inline constexpr deferred_upload_t deferred_upload{};
+
 /**
 	Contains OpenGL buffers with mesh data.
 	As long as this object exists, the data is buffered in the GPU.
+
+	The buffers are either owned by this object or sub-allocated
+	from a mesh_arena. The vertex layout is chosen by the caller
+	(or by the arena) - mesh_buffers never picks one on its own.
 */
 class mesh_buffers
 {
 	friend class fixed_vao;
 
 public:
-	mesh_buffers(const mesh_data &data);
+	mesh_buffers(const mesh_data &data, vertex_layout layout = vertex_layout::SEPARATE);
+	mesh_buffers(const mesh_data &data, const buffer_upload_func &upload, vertex_layout layout = vertex_layout::SEPARATE);
+	mesh_buffers(const mesh_data &data, std::shared_ptr<mesh_arena> arena);
+	mesh_buffers(const packed_mesh &packed, const std::vector<std::vector<meshlet>> &meshlets);
+	mesh_buffers(const packed_mesh &packed, const std::vector<std::vector<meshlet>> &meshlets, const buffer_upload_func &upload);
+	mesh_buffers(const mesh_data &data, vertex_layout layout, deferred_upload_t);
+	mesh_buffers(const mesh_data &data, std::shared_ptr<mesh_arena> arena, deferred_upload_t);
+	explicit mesh_buffers(const baked_mesh &baked);
 	
 	void bind_to_vao(fixed_vao &vao) const;
 	void bind_index_buffer() const;
 
+	vertex_layout get_vertex_layout() const
+	{
+		return m_vertex_layout;
+	}
+
+	const vao_layout &get_vao_layout() const;
+
+	//! Returns parameters the shader must use to dequantize positions
+	const vertex_quantization &get_quantization() const
+	{
+		return m_quantization;
+	}
+
+	//! Returns the arena the data lives in or nullptr if the buffers are not shared
+	const mesh_arena *get_arena() const
+	{
+		return m_arena_allocation ? &m_arena_allocation->get_arena() : nullptr;
+	}
+
+	//! Returns parameters for drawing each of the sub-meshes at given LOD
+	const std::vector<sub_mesh_draw> &get_draws(int lod = 0) const
+	{
+		return m_draws.at(lod);
+	}
+
+	//! Returns number of available LODs (at least 1)
+	int get_lod_count() const
+	{
+		return m_draws.size();
+	}
+
+	//! Returns maximum geometric error of all sub-meshes at given LOD
+	float get_lod_error(int lod) const
+	{
+		return m_lod_errors.at(lod);
+	}
+
+	const bounding_sphere &get_bounding_sphere() const
+	{
+		return m_bounding_sphere;
+	}
+
+	//! Returns meshlets of the sub-mesh (empty if it hasn't been split)
+	inline const std::vector<meshlet> &get_meshlets(int sub_mesh) const;
+
+	mesh_data read_back(const mesh_data &table) const;
+
+	/**
+		Returns the most detailed LOD of the sub-mesh that can be
+		drawn, or -1 if the sub-mesh is not resident at all
+	*/
+	int get_resident_lod(int sub_mesh) const
+	{
+		return m_resident_lods.at(sub_mesh);
+	}
+
+	bool is_resident() const
+	{
+		return !m_streaming;
+	}
+
+	GLsizeiptr stream(GLsizeiptr budget);
+	inline int get_next_stream_lod() const;
+
 private:
-	GLenum m_index_data_type;
+	/**
+		A piece of data uploaded at once during streaming. Once all units
+		of a sub-mesh LOD are uploaded, the LOD becomes resident.
+	*/
+	struct upload_unit
+	{
+		int stream;           //!< Vertex stream or -1 for indices
+		GLintptr offset;      //!< Offset in the mesh's data (bytes)
+		GLsizeiptr size;
+		int sub_mesh;
+		int lod;              //!< LOD the unit is needed for
+		bool completes_lod;   //!< Whether the LOD becomes resident after this unit
+	};
+
+	/**
+		Packed data waiting to be uploaded
+	*/
+	struct streaming_state
+	{
+		std::vector<std::vector<std::byte>> vertex_streams;
+		std::vector<std::byte> indices;
+		std::vector<upload_unit> units;
+		std::size_t next_unit = 0;
+		GLsizeiptr unit_progress = 0;
+	};
+
+	void init_info(const packed_mesh_info &info, const std::vector<std::vector<meshlet>> &meshlets);
+	void init_streaming(const mesh_data &data, packed_mesh &&packed);
+	void write_data(int stream, GLintptr offset, GLsizeiptr size, const void *data);
+	std::vector<std::byte> read_vertex_stream(int stream) const;
+	void init_draws(const std::vector<std::vector<sub_mesh_draw>> &draws, GLint base_vertex, GLintptr index_offset);
+
+	vertex_layout m_vertex_layout;
+	vertex_quantization m_quantization;
+	GLsizeiptr m_vertex_count;
+	bool m_has_uvs;
+	bounding_sphere m_bounding_sphere;
+	std::vector<std::vector<sub_mesh_draw>> m_draws;
+	std::vector<float> m_lod_errors;
+	std::vector<std::vector<meshlet>> m_meshlets;
 	std::unique_ptr<abd::gl::buffer> m_index_buffer;
-	std::unique_ptr<abd::gl::buffer> m_position_buffer;
-	std::unique_ptr<abd::gl::buffer> m_normal_buffer;
-	std::unique_ptr<abd::gl::buffer> m_uv_buffer;
+	std::vector<std::unique_ptr<abd::gl::buffer>> m_vertex_buffers;
+	std::optional<mesh_arena::allocation> m_arena_allocation;
+	std::vector<int> m_resident_lods;
+	std::unique_ptr<streaming_state> m_streaming;
 };
 
+const std::vector<meshlet> &mesh_buffers::get_meshlets(int sub_mesh) const
+{
+	static const std::vector<meshlet> empty;
+	return sub_mesh < static_cast<int>(m_meshlets.size()) ? m_meshlets[sub_mesh] : empty;
+}
+
+/**
+	Returns LOD of the data to be streamed next or -1 if everything is resident
+*/
+int mesh_buffers::get_next_stream_lod() const
+{
+	return m_streaming ? m_streaming->units[m_streaming->next_unit].lod : -1;
+}
+
 
 /**
 	Owns mesh_data and mesh_buffers.
@@ -61,25 +280,86 @@ class mesh
 {
 public:
 	template <typename T, typename = std::enable_if<std::is_same_v<std::decay_t<T>, mesh_data>>>
-	mesh(T &&data) :
+	mesh(T &&data, vertex_layout layout = vertex_layout::SEPARATE) :
 		m_data(std::forward<mesh_data>(data)),
-		m_buffers(std::make_unique<mesh_buffers>(m_data))
+		m_buffers(std::make_unique<mesh_buffers>(m_data, layout))
 	{
 	}
 
+	/**
+		Places mesh data in a shared mesh_arena
+	*/
+	template <typename T, typename = std::enable_if<std::is_same_v<std::decay_t<T>, mesh_data>>>
+	mesh(T &&data, std::shared_ptr<mesh_arena> arena) :
+		m_data(std::forward<mesh_data>(data)),
+		m_buffers(std::make_unique<mesh_buffers>(m_data, std::move(arena)))
+	{
+	}
+
+	/**
+		Takes buffers that have already been populated with the data
+		(e.g. by abd::upload_service). If the data contains only the sub-mesh
+		table (e.g. of a baked mesh), the CPU data is considered released.
+	*/
+	mesh(mesh_data &&data, std::unique_ptr<mesh_buffers> buffers) :
+		m_data(std::move(data)),
+		m_buffers(std::move(buffers)),
+		m_cpu_data_released(m_data.positions.empty())
+	{
+		if (!m_buffers)
+			throw abd::exception("abd::mesh created without buffers");
+	}
+
+	/**
+		Returns mesh data. If CPU data has been released,
+		only the sub-mesh table (sizes, materials, LODs, meshlets)
+		is available - see read_back().
+	*/
 	const mesh_data &get_data() const
 	{
 		return m_data;
 	}
 
+	/**
+		Frees vertex and index data kept in system memory.
+		The sub-mesh table is preserved.
+	*/
+	void release_cpu_data()
+	{
+		m_data.indices = {};
+		m_data.positions = {};
+		m_data.normals = {};
+		m_data.uvs = {};
+		m_cpu_data_released = true;
+	}
+
+	bool has_cpu_data() const
+	{
+		return !m_cpu_data_released;
+	}
+
+	/**
+		Returns complete mesh data - read back from the GPU if released
+	*/
+	mesh_data read_back() const
+	{
+		return m_cpu_data_released ? m_buffers->read_back(m_data) : m_data;
+	}
+
 	const mesh_buffers &get_buffers() const
 	{
 		return *m_buffers;
 	}
 
+	mesh_buffers &get_buffers()
+	{
+		return *m_buffers;
+	}
+
 private:
 	mesh_data m_data;
 	std::unique_ptr<mesh_buffers> m_buffers;
+	bool m_cpu_data_released = false;
 };
 
 
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <albedo/gl/buffer.hpp>
+#include <albedo/fixed_vao.hpp>
+#include <albedo/utils.hpp>
+#include <optional>
+#include <memory>
+#include <vector>
+#include <map>
+
+namespace abd {
+
+/**
+	A first-fit free-list allocator managing abstract ranges
+	(e.g. vertices or bytes). Adjacent free ranges are merged on release.
+*/
+class range_allocator
+{
+public:
+	explicit range_allocator(GLsizeiptr capacity);
+
+	std::optional<GLsizeiptr> allocate(GLsizeiptr size, GLsizeiptr alignment = 1);
+	void free(GLsizeiptr offset, GLsizeiptr size);
+
+	GLsizeiptr get_capacity() const
+	{
+		return m_capacity;
+	}
+
+	GLsizeiptr get_free_size() const
+	{
+		return m_free_size;
+	}
+
+private:
+	//! Free ranges - offset to size
+	std::map<GLsizeiptr, GLsizeiptr> m_free_ranges;
+	GLsizeiptr m_capacity;
+	GLsizeiptr m_free_size;
+};
+
+/**
+	A few large GPU buffers shared by many meshes. Meshes sub-allocate
+	vertex and index ranges from it, so all of them can be drawn with
+	a single VAO binding using base vertex and index buffer offsets.
+
+	Must be managed by a shared pointer - allocations keep the arena alive.
+*/
+class mesh_arena : public std::enable_shared_from_this<mesh_arena>, abd::noncopy
+{
+public:
+	class allocation;
+
+	mesh_arena(GLsizeiptr vertex_capacity, GLsizeiptr index_buffer_size, vertex_layout layout = vertex_layout::SEPARATE);
+
+	allocation allocate(GLsizeiptr vertex_count, GLsizeiptr index_size);
+
+	void write_vertices(int stream, GLsizeiptr first_vertex, GLsizeiptr vertex_count, const void *data);
+	void write_indices(GLintptr offset, GLsizeiptr size, const void *data);
+	void read_vertices(int stream, GLsizeiptr first_vertex, GLsizeiptr vertex_count, void *data) const;
+	void read_indices(GLintptr offset, GLsizeiptr size, void *data) const;
+
+	void bind_to_vao(fixed_vao &vao) const;
+	void bind_index_buffer() const;
+
+	vertex_layout get_vertex_layout() const
+	{
+		return m_vertex_layout;
+	}
+
+	gl::buffer &get_vertex_buffer(int stream)
+	{
+		return m_vertex_buffers.at(stream);
+	}
+
+	const range_allocator &get_vertex_allocator() const
+	{
+		return m_vertex_allocator;
+	}
+
+	const range_allocator &get_index_allocator() const
+	{
+		return m_index_allocator;
+	}
+
+private:
+	void free(const allocation &alloc);
+
+	vertex_layout m_vertex_layout;
+	range_allocator m_vertex_allocator;
+	range_allocator m_index_allocator;
+	std::vector<gl::buffer> m_vertex_buffers;
+	gl::buffer m_index_buffer;
+};
+
+/**
+	A range of vertices and indices sub-allocated from a mesh_arena.
+	The range is returned to the arena on destruction.
+*/
+class mesh_arena::allocation : abd::noncopy
+{
+	friend class mesh_arena;
+
+public:
+	allocation(allocation &&rhs) noexcept;
+	allocation &operator=(allocation &&rhs) noexcept;
+	~allocation();
+
+	mesh_arena &get_arena() const
+	{
+		return *m_arena;
+	}
+
+	//! Index of the first vertex in the arena
+	GLint get_base_vertex() const
+	{
+		return m_vertex_offset;
+	}
+
+	GLsizeiptr get_vertex_count() const
+	{
+		return m_vertex_count;
+	}
+
+	//! Offset of the first index in the arena's index buffer (in bytes)
+	GLintptr get_index_offset() const
+	{
+		return m_index_offset;
+	}
+
+	GLsizeiptr get_index_size() const
+	{
+		return m_index_size;
+	}
+
+private:
+	allocation(std::shared_ptr<mesh_arena> arena, GLsizeiptr vertex_offset, GLsizeiptr vertex_count, GLintptr index_offset, GLsizeiptr index_size);
+
+	std::shared_ptr<mesh_arena> m_arena;
+	GLsizeiptr m_vertex_offset;
+	GLsizeiptr m_vertex_count;
+	GLintptr m_index_offset;
+	GLsizeiptr m_index_size;
+};
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <albedo/mesh.hpp>
+#include <albedo/mesh_optimizer.hpp>
+#include <albedo/mesh_simplifier.hpp>
+#include <albedo/meshlet.hpp>
+#include <boost/filesystem.hpp>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace Assimp {
+class Importer;
+}
+
+namespace abd {
+
+/**
+	Processing applied to every imported mesh (see assimp_simple_load_mesh())
+*/
+struct mesh_import_options
+{
+	std::optional<mesh_optimizer_options> optimizer = mesh_optimizer_options{};
+	std::optional<mesh_lod_options> lods = mesh_lod_options{};
+	std::optional<meshlet_options> meshlets = meshlet_options{};
+	vertex_layout layout = vertex_layout::SEPARATE;
+};
+
+/**
+	Imports meshes on a pool of worker threads.
+
+	Each worker owns its Assimp::Importer. Import, processing (LODs,
+	optimization, meshlets) and packing into the GPU format are all done
+	by the workers. Only the buffer creation is left to the GL thread,
+	which picks up finished imports in poll() and hands the meshes out
+	through futures.
+
+	Destroying the importer waits for imports in progress. Imports which
+	haven't been handed out by poll() are cancelled - their futures
+	throw abd::exception.
+*/
+class mesh_importer
+{
+public:
+	explicit mesh_importer(unsigned int thread_count = std::thread::hardware_concurrency());
+	~mesh_importer();
+
+	mesh_importer(const mesh_importer &) = delete;
+	mesh_importer &operator=(const mesh_importer &) = delete;
+
+	mesh_importer(mesh_importer &&) = delete;
+	mesh_importer &operator=(mesh_importer &&) = delete;
+
+	std::future<std::shared_ptr<mesh>> import(const boost::filesystem::path &path, const mesh_import_options &options = {});
+	std::vector<std::future<std::shared_ptr<mesh>>> import(const std::vector<boost::filesystem::path> &paths, const mesh_import_options &options = {});
+
+	void poll();
+
+	//! Returns number of imports that haven't been handed out yet
+	std::size_t get_pending_count() const
+	{
+		std::lock_guard lock{m_mutex};
+		return m_pending_count;
+	}
+
+private:
+	//! Work on an import and a way to cancel it (fail its promise) instead
+	template <typename... Args>
+	struct task
+	{
+		std::function<void(Args...)> run;
+		std::function<void()> cancel;
+	};
+
+	void worker_main();
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_stop = false;
+	std::size_t m_pending_count = 0;
+	std::deque<task<Assimp::Importer &>> m_jobs;
+	std::vector<task<>> m_completions;
+
+	std::vector<std::thread> m_workers;
+};
+
+}
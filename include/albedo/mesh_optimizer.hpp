@@ -0,0 +1,68 @@
+#pragma once
+
+#include <albedo/gl/gl.hpp>
+#include <albedo/mesh.hpp>
+#include <vector>
+
+/**
+	\file Mesh optimization - triangle and vertex reordering for better
+	post-transform cache utilization, less overdraw and better vertex fetch locality.
+*/
+
+namespace abd {
+
+struct mesh_optimizer_options
+{
+	//! Reorder triangles for post-transform vertex cache locality
+	bool optimize_vertex_cache = true;
+
+	//! Reorder triangle clusters to reduce overdraw
+	bool optimize_overdraw = false;
+
+	//! Maximum allowed ACMR increase caused by overdraw optimization (ratio)
+	float overdraw_threshold = 1.05f;
+
+	//! Reorder vertices in order of first use
+	bool optimize_vertex_fetch = true;
+
+	//! Size of the FIFO cache used for ACMR computation
+	int cache_size = 16;
+};
+
+/**
+	Average cache miss ratio (transformed vertices per triangle)
+	of a sub-mesh before and after optimization
+*/
+struct sub_mesh_optimization_report
+{
+	float acmr_before;
+	float acmr_after;
+};
+
+/**
+	Computes ACMR of the indices simulating a FIFO cache with the given size
+*/
+float compute_acmr(const GLuint *indices, std::size_t index_count, int cache_size);
+
+/**
+	Reorders triangles for post-transform cache locality using
+	Tom Forsyth's linear-speed vertex cache optimization algorithm.
+	Indices must be smaller than vertex_count.
+*/
+std::vector<GLuint> optimize_vertex_cache(const GLuint *indices, std::size_t index_count, std::size_t vertex_count);
+
+/**
+	Reorders clusters of triangles (split where vertex cache gets flushed)
+	so that outward-facing ones are drawn first. The indices are expected
+	to be optimized for vertex cache already. The result is discarded
+	if it increases ACMR more than threshold times.
+*/
+std::vector<GLuint> optimize_overdraw(const GLuint *indices, std::size_t index_count, const glm::vec3 *positions, int cache_size, float threshold);
+
+/**
+	Optimizes all sub-meshes of the mesh (and their LODs) in place.
+	Returns ACMR of every sub-mesh before and after optimization.
+*/
+std::vector<sub_mesh_optimization_report> optimize_mesh(mesh_data &data, const mesh_optimizer_options &options = {});
+
+}
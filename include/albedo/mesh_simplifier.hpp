@@ -0,0 +1,52 @@
+#pragma once
+
+#include <albedo/gl/gl.hpp>
+#include <albedo/mesh.hpp>
+#include <vector>
+
+/**
+	\file Quadric error metrics based mesh simplification and LOD generation
+*/
+
+namespace abd {
+
+struct mesh_lod_options
+{
+	//! Maximum number of generated LODs (not including the original mesh)
+	int max_lod_count = 4;
+
+	//! Target triangle count relative to the previous LOD
+	float reduction_ratio = 0.5f;
+
+	//! LOD generation stops when a sub-mesh can't be reduced below this ratio
+	float min_reduction = 0.9f;
+};
+
+/**
+	Simplified index buffer and maximum geometric error introduced by the simplification
+*/
+struct simplification_result
+{
+	std::vector<GLuint> indices;
+	float error;
+};
+
+/**
+	Simplifies a triangle mesh using edge collapses guided by quadric error
+	metrics (Garland-Heckbert). Vertices are collapsed onto their neighbors,
+	so the vertex data does not change - only new indices are produced.
+
+	Vertices with identical positions are treated as one (e.g. on UV seams).
+	Such seam vertices are never collapsed onto others, so they keep the
+	attributes of their side of the seam. Mesh boundaries are preserved
+	with additional constraint planes.
+*/
+simplification_result simplify_mesh(const GLuint *indices, std::size_t index_count, const glm::vec3 *positions, std::size_t vertex_count, std::size_t target_index_count);
+
+/**
+	Generates a chain of LODs for every sub-mesh. LOD indices are appended
+	to the mesh index vector and described in mesh_data::lods.
+*/
+void generate_lods(mesh_data &data, const mesh_lod_options &options = {});
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <albedo/mesh.hpp>
+#include <memory>
+#include <vector>
+
+namespace abd {
+
+/**
+	Uploads mesh data progressively, limited by a per-frame byte budget.
+	Meshes become drawable as soon as their least detailed LODs are
+	uploaded - the renderer draws whatever is resident.
+
+	Data of all meshes is uploaded from the least detailed LODs. Among
+	meshes waiting for the same LOD level, the ones with lower priority
+	value go first (e.g. distance to the camera).
+
+	The packed data is kept in system memory until uploaded.
+
+	\note Streaming only limits the upload rate and orders the uploads.
+	GPU storage for all LODs of a mesh (its own buffers or an arena range)
+	is allocated in full by add() and nothing is ever evicted, so all
+	added meshes must fit in GPU memory at once.
+*/
+class mesh_streamer
+{
+public:
+	explicit mesh_streamer(GLsizeiptr frame_budget);
+
+	std::shared_ptr<mesh> add(mesh_data &&data, float priority = 0.f, vertex_layout layout = vertex_layout::SEPARATE);
+	std::shared_ptr<mesh> add(mesh_data &&data, std::shared_ptr<mesh_arena> arena, float priority = 0.f);
+	void set_priority(const std::shared_ptr<mesh> &mesh, float priority);
+
+	GLsizeiptr update();
+
+	std::size_t get_pending_count() const
+	{
+		return m_queue.size();
+	}
+
+	void set_frame_budget(GLsizeiptr budget)
+	{
+		m_frame_budget = budget;
+	}
+
+	GLsizeiptr get_frame_budget() const
+	{
+		return m_frame_budget;
+	}
+
+private:
+	struct entry
+	{
+		std::weak_ptr<mesh> mesh_ptr;
+		float priority;
+	};
+
+	std::shared_ptr<mesh> enqueue(std::shared_ptr<mesh> mesh_ptr, float priority);
+
+	std::vector<entry> m_queue;
+	GLsizeiptr m_frame_budget;
+};
+
+}
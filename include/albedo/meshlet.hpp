@@ -0,0 +1,52 @@
+#pragma once
+
+#include <albedo/gl/gl.hpp>
+#include <vector>
+
+/**
+	\file Meshlets - small clusters of triangles that can be culled individually
+*/
+
+namespace abd {
+
+struct mesh_data;
+
+/**
+	A contiguous range of triangles in a sub-mesh with bounds used for culling.
+	The whole meshlet faces away from the camera if
+	dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius
+*/
+struct meshlet
+{
+	GLint base_index;      //!< First index relative to the sub-mesh's first index
+	GLint draw_size;       //!< Number of indices
+
+	glm::vec3 center;      //!< Bounding sphere
+	float radius;
+
+	glm::vec3 cone_axis;   //!< Average normal of the triangles
+	float cone_cutoff;     //!< Sine of the normal cone's half-angle (1 - never culled)
+};
+
+struct meshlet_options
+{
+	int max_vertices = 64;
+	int max_triangles = 124;
+
+	//! Smaller sub-meshes are not split
+	int min_sub_mesh_triangles = 256;
+};
+
+/**
+	Splits sub-meshes into meshlets and stores them in mesh_data::meshlets.
+	The meshlets are built from consecutive triangles, so indices should
+	already be optimized for vertex cache (which also makes them compact).
+*/
+void build_meshlets(mesh_data &data, const meshlet_options &options = {});
+
+/**
+	Returns true if the meshlet (in world space) faces away from the camera
+*/
+bool is_meshlet_backfacing(const glm::vec3 &center, float radius, const glm::vec3 &cone_axis, float cone_cutoff, const glm::vec3 &camera_position);
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <albedo/gl/program.hpp>
+#include <albedo/gl/deferred_program.hpp>
+#include <albedo/simple_loaders.hpp>
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace abd {
+
+/**
+	On-disk cache of linked program binaries.
+
+	Entries are keyed by a hash of the preprocessed shader sources (so including
+	all defines and included files) and the driver identification (vendor,
+	renderer and version strings), so a driver update results in a cache miss
+	instead of loading a stale binary. If the driver
+	rejects a cached binary anyway, the program is compiled from source
+	and the entry is replaced.
+
+	\note Requires a current GL context. The cache must outlive
+	programs submitted with submit_program().
+*/
+class program_binary_cache
+{
+public:
+	explicit program_binary_cache(const boost::filesystem::path &dir);
+
+	gl::program get_program(const std::vector<shader_source> &sources);
+	gl::deferred_program submit_program(const std::vector<shader_source> &sources);
+
+	std::uint64_t get_key(const std::vector<shader_source> &sources) const;
+
+	//! Number of programs loaded from the cache
+	int get_hit_count() const
+	{
+		return m_hit_count;
+	}
+
+	//! Number of programs compiled from source
+	int get_miss_count() const
+	{
+		return m_miss_count;
+	}
+
+private:
+	boost::filesystem::path get_entry_path(std::uint64_t key) const;
+	std::optional<gl::program_binary> load(std::uint64_t key) const;
+	void store(std::uint64_t key, const gl::program &program) const;
+
+	boost::filesystem::path m_dir;
+	std::string m_driver_id;
+	bool m_enabled;
+	int m_hit_count = 0;
+	int m_miss_count = 0;
+};
+
+}
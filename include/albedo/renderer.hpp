@@ -1,22 +1,41 @@
 #pragma once
 
-#include <albedo/gl/synced_buffer.hpp>
+#include <albedo/gl/stream_buffer.hpp>
 #include <albedo/gl/framebuffer.hpp>
 #include <albedo/gl/texture.hpp>
 #include <albedo/gl/program.hpp>
+#include <albedo/gl/buffer_layout.hpp>
+#include <albedo/gl/binding_set.hpp>
+#include <albedo/gl/indirect.hpp>
+#include <albedo/program_cache.hpp>
+#include <albedo/shader_permutation_cache.hpp>
 #include <albedo/mesh.hpp>
 #include <albedo/camera.hpp>
+#include <boost/filesystem.hpp>
 #include <memory>
+#include <chrono>
 
 namespace abd {
 
+/**
+	LOD selection state preserved between frames
+*/
+struct mesh_lod_state
+{
+	int lod = 0;
+};
+
 /**
 	Contains all information required to draw a mesh
+
+	If lod_state is provided, the LOD is selected with hysteresis,
+	which prevents popping when the mesh stays at a LOD boundary.
 */
 struct mesh_draw_task
 {
 	glm::mat4 transform;
 	std::shared_ptr<abd::mesh> mesh_ptr;
+	std::shared_ptr<abd::mesh_lod_state> lod_state;
 };
 
 
@@ -159,10 +178,29 @@ class deferred_renderer
 {
 public:
 	struct gbuffer;
+	struct ubo_frame_data;
 	struct ubo_light_data;
 	struct ubo_material_data;
 
-	deferred_renderer(int width, int height);
+	/**
+		Linked programs are cached in program_cache_dir (see program_binary_cache).
+		An empty path disables the cache.
+
+		The constructor doesn't wait for the shaders to compile - they're
+		finished before the first frame is rendered (see is_ready()).
+	*/
+	deferred_renderer(int width, int height, const boost::filesystem::path &program_cache_dir = "albedo_cache");
+
+	bool is_ready() const;
+
+	/**
+		Sets sub-pixel offset (in pixels) of the projection used for the
+		following frames, e.g. for temporal antialiasing
+	*/
+	void set_jitter(const glm::vec2 &jitter)
+	{
+		m_jitter = jitter;
+	}
 
 	void render(abd::draw_task_list draw_tasks, const abd::camera &camer, GLuint output_fbo);
 
@@ -171,10 +209,97 @@ public:
 private:
 	static const int max_light_count = 128;
 
-	void prepare_lights_data(std::vector<light_draw_task> &light_tasks, gl::synced_buffer_handle &lights_buffer_chunk);
+	// Uniform buffer binding points shared by all programs (see albedo/common)
+	static const GLuint frame_ubo_binding = 0;
+	static const GLuint lights_ubo_binding = 1;
+
+	//! Size of transient data that can be streamed to the GPU each frame
+	static const GLsizeiptr stream_buffer_frame_size = 1 << 20;
+
+	// Automatic exposure settings
+	static const int histogram_bin_count = 256;
+	static constexpr float min_log_luminance = -10.f;
+	static constexpr float log_luminance_range = 14.f;
+	static constexpr float exposure_adaptation_speed = 1.5f;
+	static constexpr float exposure_key = 0.18f;
+
+	// LOD selection settings - maximum projected geometric error (in pixels)
+	// and relative margin around it, within which the LOD doesn't change
+	static constexpr float lod_error_threshold = 1.f;
+	static constexpr float lod_hysteresis = 0.25f;
+
+	/**
+		A program being compiled and the renderer member it's stored in once finished
+	*/
+	struct pending_program
+	{
+		gl::program *deferred_renderer::*target;
+		boost::filesystem::path dir;
+	};
+
+	/**
+		Handles of uniforms used by the renderer, resolved
+		once the programs are linked (see init_uniform_handles())
+	*/
+	struct geometry_uniforms
+	{
+		gl::uniform_handle<glm::mat4> mat_model;
+		gl::uniform_handle<glm::vec3> position_scale, position_bias;
+		gl::uniform_handle<glm::vec3> material_diffuse;
+		gl::uniform_handle<GLfloat> material_specular, material_roughness, material_specular_tint;
+	};
+
+	struct shading_uniforms
+	{
+		gl::uniform_handle<GLint> base_light_index, light_count;
+	};
+
+	struct histogram_uniforms
+	{
+		gl::uniform_handle<GLfloat> min_log_luminance, inv_log_luminance_range;
+	};
+
+	struct exposure_uniforms
+	{
+		gl::uniform_handle<GLfloat> min_log_luminance, log_luminance_range;
+		gl::uniform_handle<GLint> pixel_count;
+		gl::uniform_handle<GLfloat> adaptation_rate, exposure_key;
+	};
+
+	void finish_programs();
+	void init_uniform_handles();
+	void check_buffer_layouts() const;
+	void prepare_frame_data(const abd::camera &camera, float dt);
+	void prepare_lights_data(std::vector<light_draw_task> &light_tasks, const gl::stream_allocation &lights_data);
 	
+	/**
+		Result of culling a mesh draw task. Sub-meshes split into meshlets
+		are drawn with indirect commands - first_command and command_count
+		refer to them. Command count of -1 means the whole sub-mesh is drawn.
+
+		The LOD of a sub-mesh may be less detailed than the selected one
+		if the mesh is still being streamed. LOD of -1 means that the
+		sub-mesh is not resident at all.
+	*/
+	struct mesh_visibility
+	{
+		struct sub_mesh_commands
+		{
+			int lod;
+			int first_command;
+			int command_count;
+		};
+
+		bool visible;
+		int lod;
+		std::vector<sub_mesh_commands> sub_meshes;
+	};
+
+	int select_lod(const mesh_draw_task &task, const abd::camera &camera) const;
+	mesh_visibility cull_mesh(const mesh_draw_task &task, const abd::camera &camera, const abd::frustum &view_frustum, std::vector<gl::draw_elements_indirect_command> &commands) const;
 	void geometry_pass(std::vector<mesh_draw_task> &mesh_tasks, const abd::camera &camera);
-	void lighting_pass(std::vector<light_draw_task> &light_tasks, gl::synced_buffer_handle &lights_buffer_chunk, const abd::camera &camera);
+	void lighting_pass(std::vector<light_draw_task> &light_tasks, const gl::stream_allocation &lights_data);
+	void exposure_pass(float dt);
 	void postprocess_to_output(GLuint output_fbo);
 
 	/**
@@ -192,28 +317,94 @@ private:
 	abd::gl::buffer m_blit_quad;
 	
 	/**
-		Contains information about all the lights to be processed
+		All transient per-frame data (e.g. light information) is allocated here
+	*/
+	abd::gl::stream_buffer m_stream_buffer;
+
+	/**
+		Log-luminance histogram of the color buffer. Cleared by the
+		exposure adaptation shader after use.
+	*/
+	abd::gl::buffer m_histogram_buffer;
+
+	/**
+		Adapted average luminance and resulting exposure. Never read back
+		by the CPU - the postprocess shader reads it directly.
 	*/
-	abd::gl::synced_buffer m_lights_buffer;
+	abd::gl::buffer m_exposure_buffer;
+
+	//! Used for computing exposure adaptation rate
+	std::chrono::steady_clock::time_point m_last_frame_time;
+
+	//! Time passed to the shaders is relative to this
+	std::chrono::steady_clock::time_point m_start_time;
+
+	//! Sub-pixel projection offset (see set_jitter())
+	glm::vec2 m_jitter{0.f};
 
 	/**
 		The main VAO - input stage for the geomatry pass shaders
 	*/
 	abd::fixed_vao m_vao{abd::standard_vao_layout};
 
+	//! VAO used in the geometry pass for meshes with interleaved vertex data
+	abd::fixed_vao m_interleaved_vao{abd::interleaved_vao_layout};
+
+	//! VAO used in the geometry pass for meshes with compressed vertex data
+	abd::fixed_vao m_compact_vao{abd::compact_vao_layout};
+
 
 	// Framebuffer
 	int m_fbo_width;
 	int m_fbo_height;
 	gl::framebuffer m_fbo;
 
-	std::unique_ptr<gl::program> m_geometry_program;
-	std::unique_ptr<gl::program> m_shading_program;
-	std::unique_ptr<gl::program> m_postprocess_program;
+	std::unique_ptr<program_binary_cache> m_program_cache;
+	std::unique_ptr<shader_permutation_cache> m_shader_cache;
+	std::vector<pending_program> m_pending_programs;
+
+	// Programs owned by the shader cache
+	gl::program *m_geometry_program = nullptr;
+	gl::program *m_shading_program = nullptr;
+	gl::program *m_postprocess_program = nullptr;
+	gl::program *m_histogram_program = nullptr;
+	gl::program *m_exposure_program = nullptr;
+
+	geometry_uniforms m_geometry_uniforms;
+	shading_uniforms m_shading_uniforms;
+	histogram_uniforms m_histogram_uniforms;
+	exposure_uniforms m_exposure_uniforms;
+
+	/**
+		Resources used by the passes, recorded once the textures are created.
+		Texture units correspond to layout(binding) of the samplers.
+	*/
+	gl::binding_set m_shading_bindings;
+	gl::binding_set m_exposure_bindings;
+	gl::binding_set m_postprocess_bindings;
+};
+
+/**
+	Per-frame constants passed to all programs in FRAME_UBO
+	(must correspond to albedo/common/frame.glsl, see check_buffer_layouts())
+*/
+struct deferred_renderer::ubo_frame_data
+{
+	glm::mat4 mat_view;
+	glm::mat4 mat_proj;
+	glm::mat4 mat_vp;
+	glm::mat4 mat_inv_view;
+	glm::mat4 mat_inv_proj;
+	glm::mat4 mat_inv_vp;
+	glm::vec2 viewport_size;
+	glm::vec2 inv_viewport_size;
+	glm::vec2 jitter;
+	GLfloat time;
+	GLfloat delta_time;
 };
 
 /**
-	Light data passed to the shaders in UBO.
+	Light data passed to the shaders in UBO (see check_buffer_layouts()).
 	Data in this struct corresponds to the data light_draw_task
 	but is more packed.
 */
@@ -221,9 +412,7 @@ struct deferred_renderer::ubo_light_data
 {
 	GLint light_type;   //!< Determines light type (not the volume type)
 	GLfloat blend;
-	GLfloat dummy1;
-	GLfloat dummy2;
-	glm::vec4 color_specular;
+	alignas(16) glm::vec4 color_specular;
 	glm::vec4 position_distance;
 	glm::vec4 direction_angle;
 };
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace abd {
+
+/**
+	A file embedded in the library at build time
+*/
+struct embedded_file
+{
+	std::string_view path;
+	std::string_view contents;
+};
+
+/**
+	Contents of the albedo/ shader directory (paths relative to it).
+	Generated by cmake/embed_shaders.cmake.
+*/
+extern const embedded_file *const embedded_shaders;
+extern const std::size_t embedded_shader_count;
+
+/**
+	SPIR-V modules compiled from the shader stages in albedo/ (paths of
+	the GLSL sources). Empty if glslangValidator wasn't available at build time.
+	Contents are aligned to 4 bytes, as glShaderBinary() expects SPIR-V words.
+*/
+extern const embedded_file *const embedded_spirv;
+extern const std::size_t embedded_spirv_count;
+
+/**
+	Provides shader files - either the ones embedded in the library
+	or files read from a directory on disk.
+*/
+class shader_files
+{
+public:
+	//! Files read from disk, relative to the root directory
+	explicit shader_files(boost::filesystem::path root = {});
+
+	static shader_files embedded();
+	static shader_files albedo_shaders();
+
+	bool is_embedded() const
+	{
+		return !m_root.has_value();
+	}
+
+	std::optional<std::string> read(const boost::filesystem::path &path) const;
+	std::optional<std::string_view> read_spirv(const boost::filesystem::path &path) const;
+	std::vector<boost::filesystem::path> list(const boost::filesystem::path &dir) const;
+
+private:
+	shader_files(std::nullopt_t);
+
+	//! Root directory or none for embedded files
+	std::optional<boost::filesystem::path> m_root;
+};
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <albedo/gl/program.hpp>
+#include <albedo/gl/deferred_program.hpp>
+#include <albedo/shader_preprocessor.hpp>
+#include <albedo/program_cache.hpp>
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace abd {
+
+/**
+	Variants of shader programs specialized with sets of defines.
+
+	A variant is identified by the program directory and the define set
+	(order and duplicates don't matter). Variants are compiled lazily - on
+	first request - and variants whose preprocessed sources are identical
+	(e.g. because they differ only in defines the program doesn't use)
+	share one program.
+
+	If a program_binary_cache is provided, it's used for all variants
+	and it must outlive this object.
+
+	Programs whose every stage has a SPIR-V module (see shader_files::read_spirv())
+	are created from SPIR-V if the driver supports it. Defines naming
+	specialization constants declared as:
+		layout (constant_id = N) const int NAME = ...;
+	are passed as specialization constants (int, uint, float and bool are
+	supported). A variant uses GLSL sources if any other define is
+	referenced by the program. If a SPIR-V program fails to link,
+	its GLSL sources are submitted instead.
+
+	Uniforms are looked up by name, so SPIR-V is only usable if the driver
+	reflects the names. The first SPIR-V program of every program directory
+	is linked right away to find out - if the names are missing (or it fails
+	to link), the directory's programs are built from GLSL sources.
+*/
+class shader_permutation_cache
+{
+public:
+	explicit shader_permutation_cache(shader_preprocessor preprocessor, program_binary_cache *binary_cache = nullptr, bool use_spirv = true);
+
+	void submit(const boost::filesystem::path &program_dir, const std::vector<std::string> &defines = {});
+	bool is_ready(const boost::filesystem::path &program_dir, const std::vector<std::string> &defines = {});
+	gl::program &get(const boost::filesystem::path &program_dir, const std::vector<std::string> &defines = {});
+
+	//! Number of distinct variants requested
+	std::size_t get_variant_count() const
+	{
+		return m_variants.size();
+	}
+
+	//! Number of distinct programs compiled
+	std::size_t get_program_count() const
+	{
+		return m_programs.size();
+	}
+
+private:
+	/**
+		A program - either still being compiled or finished
+	*/
+	struct program_entry
+	{
+		std::optional<gl::deferred_program> pending;
+		std::unique_ptr<gl::program> program;
+
+		//! Preprocessed sources used if a SPIR-V program fails to link
+		std::vector<shader_source> fallback_sources;
+	};
+
+	//! A specialization constant declared in the program sources
+	struct spirv_constant
+	{
+		GLuint id;
+		std::string type;
+	};
+
+	//! SPIR-V modules of all stages of a program
+	struct spirv_program
+	{
+		std::vector<std::pair<GLenum, std::string_view>> modules;
+		std::map<std::string, spirv_constant> constants;
+
+		//! Whether a program has been linked from the modules already
+		bool checked = false;
+	};
+
+	program_entry &find_variant(const boost::filesystem::path &program_dir, const std::vector<std::string> &defines);
+	const std::vector<shader_source> &get_sources(const boost::filesystem::path &program_dir);
+	spirv_program *get_spirv(const boost::filesystem::path &program_dir);
+	bool has_program(std::uint64_t hash) const;
+	static std::uint64_t hash_sources(const std::vector<shader_source> &sources);
+	static std::uint64_t hash_spirv(const spirv_program &spirv, const std::vector<gl::specialization_constant> &constants);
+	static std::optional<std::vector<gl::specialization_constant>> specialize(const spirv_program &spirv, const std::vector<std::string> &defines, const std::vector<shader_source> &sources);
+	static std::vector<gl::shader> make_spirv_shaders(const spirv_program &spirv, const std::vector<gl::specialization_constant> &constants);
+	std::unique_ptr<gl::program> check_spirv_support(const spirv_program &spirv, const std::vector<gl::specialization_constant> &constants);
+	gl::deferred_program submit_sources(const std::vector<shader_source> &sources);
+	void finish_spirv(program_entry &entry);
+
+	shader_preprocessor m_preprocessor;
+	program_binary_cache *m_binary_cache;
+	bool m_use_spirv;
+
+	//! Raw sources of every program directory
+	std::map<std::string, std::vector<shader_source>> m_sources;
+
+	//! SPIR-V modules of every program directory (if available and usable)
+	std::map<std::string, std::optional<spirv_program>> m_spirv;
+
+	//! Programs by hash of their preprocessed sources
+	std::map<std::uint64_t, std::unique_ptr<program_entry>> m_programs;
+
+	//! Variants (program directory and normalized defines) and their programs
+	std::map<std::pair<std::string, std::vector<std::string>>, program_entry *> m_variants;
+};
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <albedo/gl/gl.hpp>
+#include <albedo/shader_files.hpp>
+#include <boost/filesystem.hpp>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace abd {
+
+/**
+	Source code of a shader and its type. The path is used
+	for resolving includes and in error messages.
+*/
+struct shader_source
+{
+	GLenum type;
+	std::string source;
+	boost::filesystem::path path;
+};
+
+/**
+	Expands #include directives and injects #define directives into shader sources.
+
+	#include "file" is resolved relative to the including file first and then in
+	the include directories. #include <file> is only looked up in the include
+	directories. Every file is included at most once per shader (as if it used
+	include guards). #line directives are emitted, so compilation logs refer
+	to lines in the original files - source string 0 is the shader itself and
+	included files are numbered in order of inclusion.
+
+	Files are read from the given shader_files (disk relative to the working
+	directory by default), so shaders embedded in the library can include
+	each other as well.
+
+	Defines ("NAME" or "NAME VALUE") are inserted after the #version directive.
+	Only defines whose name appears in the expanded source are inserted, so
+	define sets differing only in names a shader doesn't use produce identical
+	sources (see shader_permutation_cache).
+*/
+class shader_preprocessor
+{
+public:
+	explicit shader_preprocessor(std::vector<boost::filesystem::path> include_dirs = {}, shader_files files = shader_files{});
+
+	const shader_files &get_files() const
+	{
+		return m_files;
+	}
+
+	void add_include_dir(const boost::filesystem::path &dir)
+	{
+		m_include_dirs.push_back(dir);
+	}
+
+	shader_source process(const shader_source &source, const std::vector<std::string> &defines = {}) const;
+	std::vector<shader_source> process(const std::vector<shader_source> &sources, const std::vector<std::string> &defines = {}) const;
+
+private:
+	//! State of processing of a single shader
+	struct expansion
+	{
+		std::string output;
+		std::set<std::string> included;
+		int file_count = 0;
+	};
+
+	//! Maximum depth of nested includes
+	static const int max_include_depth = 32;
+
+	//! Path and contents of the included file
+	std::pair<boost::filesystem::path, std::string> resolve_include(const std::string &name, bool system, const boost::filesystem::path &including_path) const;
+	void expand(const std::string &source, const boost::filesystem::path &path, int source_index, int depth, expansion &state) const;
+
+	std::vector<boost::filesystem::path> m_include_dirs;
+	shader_files m_files;
+};
+
+}
@@ -2,9 +2,20 @@
 
 #include <albedo/gl/shader.hpp>
 #include <albedo/gl/program.hpp>
+#include <albedo/gl/deferred_program.hpp>
+#include <albedo/shader_preprocessor.hpp>
 #include <albedo/mesh.hpp>
+#include <albedo/mesh_optimizer.hpp>
+#include <albedo/mesh_simplifier.hpp>
+#include <optional>
+#include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
 
+namespace Assimp {
+class Importer;
+}
+
 /**
 	\file A buch of simple functional loaders.
 */
@@ -14,8 +25,32 @@ namespace abd {
 /**
 	Loads mesh data with assimp. All meshes in the Assimp scene are loaded into
 	the compound mesh.
+
+	Unless LOD options are empty, LOD chains are generated for all sub-meshes.
+	Unless optimizer options are empty, the mesh is optimized. ACMR of every
+	sub-mesh before and after optimization is stored in optimization_report
+	if it's not null.
+	Unless meshlet options are empty, large sub-meshes are split into meshlets.
+*/
+abd::mesh_data assimp_simple_load_mesh(
+	const boost::filesystem::path &path,
+	const std::optional<mesh_optimizer_options> &optimizer = mesh_optimizer_options{},
+	const std::optional<mesh_lod_options> &lods = mesh_lod_options{},
+	const std::optional<meshlet_options> &meshlets = meshlet_options{},
+	std::vector<sub_mesh_optimization_report> *optimization_report = nullptr);
+
+/**
+	Loads mesh data using the provided importer. An Assimp::Importer
+	must not be used by more than one thread at a time, but separate
+	importers can be used concurrently (see mesh_importer).
 */
-abd::mesh_data assimp_simple_load_mesh(const boost::filesystem::path &path);
+abd::mesh_data assimp_simple_load_mesh(
+	Assimp::Importer &importer,
+	const boost::filesystem::path &path,
+	const std::optional<mesh_optimizer_options> &optimizer = mesh_optimizer_options{},
+	const std::optional<mesh_lod_options> &lods = mesh_lod_options{},
+	const std::optional<meshlet_options> &meshlets = meshlet_options{},
+	std::vector<sub_mesh_optimization_report> *optimization_report = nullptr);
 
 /**
 	Slurps file and compiles it as a shader
@@ -23,6 +58,24 @@ abd::mesh_data assimp_simple_load_mesh(const boost::filesystem::path &path);
 abd::gl::shader simple_load_shader(GLenum type, const boost::filesystem::path &path);
 
 
+/**
+	Reads sources of all shaders in the directory. Shader type is derived
+	from file extension (see simple_load_shader_dir()). By default, the
+	files are read from disk.
+*/
+std::vector<shader_source> simple_read_shader_dir(const boost::filesystem::path &dir, const shader_files &files = shader_files{});
+
+/**
+	Compiles the shaders (as they are) and links them into one program
+*/
+abd::gl::program simple_build_program(const std::vector<shader_source> &sources);
+
+/**
+	Submits the shaders for compilation and linking without waiting
+	for the result (see gl::deferred_program)
+*/
+abd::gl::deferred_program simple_submit_program(const std::vector<shader_source> &sources, abd::gl::deferred_program::link_callback on_link = {});
+
 /**
 	Reads all shaders in the directory and links them into one program.
 	Shader type is derived from file extension:
@@ -32,8 +85,11 @@ abd::gl::shader simple_load_shader(GLenum type, const boost::filesystem::path &p
 		- .tes.glsl - GL_TESS_EVALUATION_SHADER
 		- .cs.glsl - GL_COMPUTE_SHADER
 		- .gs.glsl - GL_GEOMETRY_SHADER
+
+	The sources are read using the preprocessor's shader_files and processed
+	by the preprocessor (includes) before compilation.
 */
-abd::gl::program simple_load_shader_dir(const boost::filesystem::path &dir);
+abd::gl::program simple_load_shader_dir(const boost::filesystem::path &dir, const shader_preprocessor &preprocessor = shader_preprocessor{});
 
 
 }
\ No newline at end of file
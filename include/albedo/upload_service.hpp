@@ -0,0 +1,90 @@
+#pragma once
+
+#include <albedo/gl/window.hpp>
+#include <albedo/gl/fence.hpp>
+#include <albedo/gl/stream_buffer.hpp>
+#include <albedo/mesh.hpp>
+#include <albedo/texture.hpp>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <vector>
+
+namespace abd {
+
+/**
+	Pixel data of a 2D texture to be uploaded
+*/
+struct texture_2d_data
+{
+	gl::texture_format internal_format;
+	GLsizei width;
+	GLsizei height;
+	GLsizei levels;
+
+	//! Format and type of the pixel data, e.g. GL_RGBA and GL_UNSIGNED_BYTE
+	GLenum format;
+	GLenum type;
+	std::vector<std::uint8_t> pixels;
+};
+
+/**
+	Uploads meshes and textures asynchronously.
+
+	A worker thread owns a hidden window whose context is shared with
+	the main one. Data is copied to GPU buffers through persistently mapped
+	staging buffers and each upload is fenced. Once the render thread sees
+	the fence signaled (in poll()), the resulting object is handed out
+	through a future and can be drawn immediately.
+
+	\note The service has to be created and destroyed on the main thread (GLFW requirement)
+*/
+class upload_service
+{
+public:
+	explicit upload_service(gl::window &main_window, GLsizeiptr staging_size = 16 << 20);
+	~upload_service();
+
+	upload_service(const upload_service &) = delete;
+	upload_service &operator=(const upload_service &) = delete;
+
+	upload_service(upload_service &&) = delete;
+	upload_service &operator=(upload_service &&) = delete;
+
+	std::future<std::shared_ptr<abd::mesh>> upload_mesh(abd::mesh_data &&data, vertex_layout layout = vertex_layout::SEPARATE);
+	std::future<std::shared_ptr<abd::texture_2d>> upload_texture_2d(texture_2d_data &&data);
+
+	void poll();
+
+private:
+	/**
+		Finished upload waiting for its fence. The callback
+		is executed on the render thread.
+	*/
+	struct completion
+	{
+		gl::fence_sync fence;
+		std::function<void()> callback;
+	};
+
+	void worker_main();
+	void complete(std::function<void()> callback);
+	std::unique_ptr<gl::buffer> stage_buffer(const void *data, GLsizeiptr size, GLbitfield flags);
+
+	GLsizeiptr m_staging_size;
+	gl::window m_context_window;
+	std::unique_ptr<gl::stream_buffer> m_staging;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_stop = false;
+	std::deque<std::function<void()>> m_jobs;
+	std::vector<completion> m_completions;
+
+	std::thread m_worker;
+};
+
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
 namespace abd {
 
 /**
@@ -19,5 +23,32 @@ protected:
 	~noncopy() = default;
 };
 
+/**
+	64-bit FNV-1a hash
+*/
+class fnv1a_hash
+{
+public:
+	void add(const void *data, std::size_t size)
+	{
+		auto bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0; i < size; i++)
+			m_hash = (m_hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+
+	//! Adds the string along with its terminator, so concatenations don't collide
+	void add(const std::string &str)
+	{
+		add(str.c_str(), str.size() + 1);
+	}
+
+	std::uint64_t get() const
+	{
+		return m_hash;
+	}
+
+private:
+	std::uint64_t m_hash = 0xcbf29ce484222325ull;
+};
 
 }
\ No newline at end of file
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <albedo/gl/vertex_array.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace abd {
+
+/**
+	Per-mesh parameters for dequantization of vertex positions.
+	The shader computes position = stored_position * position_scale + position_bias.
+*/
+struct vertex_quantization
+{
+	glm::vec3 position_scale{1.f};
+	glm::vec3 position_bias{0.f};
+
+	static vertex_quantization from_positions(const std::vector<glm::vec3> &positions);
+};
+
+/**
+	Vertex attribute formats. Each format provides:
+		- packed_type - type stored in the vertex buffer
+		- size, type, normalized - parameters for glVertexArrayAttribFormat()
+		- quantized - whether values have to be mapped to [-1; 1] before packing
+		- pack() - conversion from the floating-point value
+		- unpack() - conversion back to the floating-point value
+*/
+namespace attrib_format {
+
+//! 3 32-bit floats (12 bytes)
+struct float3
+{
+	using packed_type = glm::vec3;
+	static constexpr GLint size = 3;
+	static constexpr GLenum type = GL_FLOAT;
+	static constexpr GLboolean normalized = GL_FALSE;
+	static constexpr bool quantized = false;
+
+	static packed_type pack(const glm::vec3 &v)
+	{
+		return v;
+	}
+
+	static glm::vec3 unpack(const packed_type &v)
+	{
+		return v;
+	}
+};
+
+//! 2 32-bit floats (8 bytes)
+struct float2
+{
+	using packed_type = glm::vec2;
+	static constexpr GLint size = 2;
+	static constexpr GLenum type = GL_FLOAT;
+	static constexpr GLboolean normalized = GL_FALSE;
+	static constexpr bool quantized = false;
+
+	static packed_type pack(const glm::vec2 &v)
+	{
+		return v;
+	}
+
+	static glm::vec2 unpack(const packed_type &v)
+	{
+		return v;
+	}
+};
+
+//! 3 normalized 16-bit integers padded to 8 bytes. Requires quantization.
+struct snorm16x3
+{
+	struct packed_type
+	{
+		std::int16_t x, y, z, w;
+	};
+
+	static constexpr GLint size = 3;
+	static constexpr GLenum type = GL_SHORT;
+	static constexpr GLboolean normalized = GL_TRUE;
+	static constexpr bool quantized = true;
+
+	static packed_type pack(const glm::vec3 &v)
+	{
+		return {
+			static_cast<std::int16_t>(glm::packSnorm1x16(v.x)),
+			static_cast<std::int16_t>(glm::packSnorm1x16(v.y)),
+			static_cast<std::int16_t>(glm::packSnorm1x16(v.z)),
+			0
+		};
+	}
+
+	static glm::vec3 unpack(const packed_type &v)
+	{
+		return {
+			glm::unpackSnorm1x16(static_cast<std::uint16_t>(v.x)),
+			glm::unpackSnorm1x16(static_cast<std::uint16_t>(v.y)),
+			glm::unpackSnorm1x16(static_cast<std::uint16_t>(v.z))
+		};
+	}
+};
+
+//! 3 normalized 10-bit integers packed in 4 bytes (10:10:10:2)
+struct snorm10x3
+{
+	using packed_type = std::uint32_t;
+	static constexpr GLint size = 4;
+	static constexpr GLenum type = GL_INT_2_10_10_10_REV;
+	static constexpr GLboolean normalized = GL_TRUE;
+	static constexpr bool quantized = false;
+
+	static packed_type pack(const glm::vec3 &v)
+	{
+		return glm::packSnorm3x10_1x2(glm::vec4(glm::clamp(v, -1.f, 1.f), 0.f));
+	}
+
+	static glm::vec3 unpack(const packed_type &v)
+	{
+		return glm::vec3{glm::unpackSnorm3x10_1x2(v)};
+	}
+};
+
+//! 2 16-bit floats (4 bytes)
+struct half2
+{
+	using packed_type = std::uint32_t;
+	static constexpr GLint size = 2;
+	static constexpr GLenum type = GL_HALF_FLOAT;
+	static constexpr GLboolean normalized = GL_FALSE;
+	static constexpr bool quantized = false;
+
+	static packed_type pack(const glm::vec2 &v)
+	{
+		return glm::packHalf2x16(v);
+	}
+
+	static glm::vec2 unpack(const packed_type &v)
+	{
+		return glm::unpackHalf2x16(v);
+	}
+};
+
+}
+
+/**
+	Compile-time description of an interleaved vertex format.
+	Generates both the vertex structure, VAO attribute configurations
+	and the packing code. All attributes are sourced from binding 0.
+*/
+template <typename Position, typename Normal, typename UV>
+struct vertex_format
+{
+	struct vertex
+	{
+		typename Position::packed_type position;
+		typename Normal::packed_type normal;
+		typename UV::packed_type uv;
+	};
+
+	//! Whether positions need per-mesh dequantization parameters
+	static constexpr bool quantized_positions = Position::quantized;
+
+	template <typename Attrib>
+	static gl::vao_attribute_config make_attribute_config(std::size_t offset)
+	{
+		return {0, Attrib::size, Attrib::type, Attrib::normalized, static_cast<GLuint>(offset)};
+	}
+
+	static gl::vao_attribute_config position_config()
+	{
+		return make_attribute_config<Position>(offsetof(vertex, position));
+	}
+
+	static gl::vao_attribute_config normal_config()
+	{
+		return make_attribute_config<Normal>(offsetof(vertex, normal));
+	}
+
+	static gl::vao_attribute_config uv_config()
+	{
+		return make_attribute_config<UV>(offsetof(vertex, uv));
+	}
+
+	/**
+		Packs a single vertex. Positions are mapped with inverse of
+		the quantization transform if required by the format.
+	*/
+	static vertex pack(const glm::vec3 &position, const glm::vec3 &normal, const glm::vec2 &uv, const vertex_quantization &q)
+	{
+		glm::vec3 p = quantized_positions ? (position - q.position_bias) / q.position_scale : position;
+		return {Position::pack(p), Normal::pack(normal), UV::pack(uv)};
+	}
+
+	/**
+		Reverses pack() (within precision of the format)
+	*/
+	static void unpack(const vertex &v, const vertex_quantization &q, glm::vec3 &position, glm::vec3 &normal, glm::vec2 &uv)
+	{
+		position = Position::unpack(v.position);
+		if (quantized_positions)
+			position = position * q.position_scale + q.position_bias;
+
+		normal = Normal::unpack(v.normal);
+		uv = UV::unpack(v.uv);
+	}
+};
+
+//! Full precision format - 32 bytes per vertex
+using interleaved_vertex_format = vertex_format<attrib_format::float3, attrib_format::float3, attrib_format::float2>;
+
+//! Compressed format - 16 bytes per vertex
+using compact_vertex_format = vertex_format<attrib_format::snorm16x3, attrib_format::snorm10x3, attrib_format::half2>;
+
+static_assert(sizeof(interleaved_vertex_format::vertex) == 32, "interleaved vertex must not be padded");
+static_assert(sizeof(compact_vertex_format::vertex) == 16, "compact vertex must not be padded");
+
+}
@@ -0,0 +1,413 @@
+#include <albedo/baked_mesh.hpp>
+#include <albedo/exception.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <type_traits>
+
+using abd::baked_mesh;
+
+namespace {
+
+/**
+	Baked mesh file layout:
+		- header
+		- table (sub-mesh table and locations of the blobs)
+		- vertex streams and indices (each aligned to blob_alignment)
+*/
+struct file_header
+{
+	char magic[4];
+	std::uint32_t version;
+	std::uint64_t table_offset;
+	std::uint64_t table_size;
+};
+
+constexpr char file_magic[4] = {'A', 'B', 'D', 'M'};
+constexpr std::uint32_t file_version = 2;
+constexpr std::size_t blob_alignment = 64;
+
+//! Index ranges are stored relative to the beginning of the blob
+struct file_blob
+{
+	std::uint64_t offset;
+	std::uint64_t size;
+};
+
+struct file_draw
+{
+	std::uint32_t count;
+	std::uint32_t index_type;
+	std::uint64_t index_offset;
+	std::int32_t base_vertex;
+	std::uint32_t padding;
+};
+
+struct file_material
+{
+	float diffuse[3];
+	float specular;
+	float roughness;
+	float specular_tint;
+	std::uint32_t two_sided;
+};
+
+constexpr std::uint32_t no_material = ~0u;
+
+/**
+	Serializes trivially copyable values into a byte vector
+*/
+class table_writer
+{
+public:
+	template <typename T>
+	void put(const T &value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable types can be baked");
+		auto ptr = reinterpret_cast<const std::byte*>(&value);
+		m_data.insert(m_data.end(), ptr, ptr + sizeof(T));
+	}
+
+	template <typename T>
+	void put_array(const std::vector<T> &v)
+	{
+		put<std::uint32_t>(v.size());
+		for (const auto &value : v)
+			put(value);
+	}
+
+	const std::vector<std::byte> &get_data() const
+	{
+		return m_data;
+	}
+
+private:
+	std::vector<std::byte> m_data;
+};
+
+/**
+	Deserializes values written by table_writer. Throws if the data ends prematurely.
+*/
+class table_reader
+{
+public:
+	table_reader(const std::byte *begin, const std::byte *end) :
+		m_ptr(begin),
+		m_end(end)
+	{
+	}
+
+	template <typename T>
+	T get()
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable types can be baked");
+		if (m_end - m_ptr < static_cast<std::ptrdiff_t>(sizeof(T)))
+			throw abd::exception("baked mesh table is truncated");
+
+		T value;
+		std::memcpy(&value, m_ptr, sizeof(T));
+		m_ptr += sizeof(T);
+		return value;
+	}
+
+	template <typename T>
+	std::vector<T> get_array()
+	{
+		std::vector<T> v(get<std::uint32_t>());
+		for (auto &value : v)
+			value = get<T>();
+		return v;
+	}
+
+private:
+	const std::byte *m_ptr;
+	const std::byte *m_end;
+};
+
+}
+
+/**
+	The table is written first, because blob offsets depend only on its size,
+	which doesn't depend on the offsets themselves.
+*/
+void abd::bake_mesh(const boost::filesystem::path &path, const mesh_data &data, vertex_layout layout)
+{
+	auto packed = abd::pack_mesh(data, layout);
+	const auto &info = packed.info;
+
+	// Unique materials
+	std::vector<std::shared_ptr<material>> materials;
+	std::map<std::shared_ptr<material>, std::uint32_t> material_index;
+	std::vector<std::uint32_t> sub_mesh_materials;
+	for (std::size_t i = 0; i < data.draw_sizes.size(); i++)
+	{
+		if (i >= data.materials.size() || !data.materials[i])
+		{
+			sub_mesh_materials.push_back(no_material);
+			continue;
+		}
+
+		auto [it, inserted] = material_index.emplace(data.materials[i], materials.size());
+		if (inserted) materials.push_back(data.materials[i]);
+		sub_mesh_materials.push_back(it->second);
+	}
+
+	// Blob locations - the table size is computed with placeholder offsets
+	std::vector<file_blob> blobs;
+	for (const auto &stream : packed.vertex_streams)
+		blobs.push_back({0, stream.size()});
+	blobs.push_back({0, packed.indices.size()});
+
+	auto write_table = [&](table_writer &table)
+	{
+		table.put<std::uint32_t>(static_cast<std::uint32_t>(info.layout));
+		table.put<std::uint32_t>(info.has_uvs);
+		table.put<std::uint64_t>(info.vertex_count);
+		table.put(info.quantization);
+		table.put(info.bounds);
+		table.put_array(info.lod_errors);
+		table.put_array(blobs);
+
+		table.put<std::uint32_t>(data.draw_sizes.size());
+		table.put<std::uint32_t>(info.draws.size());
+		for (const auto &lod : info.draws)
+			for (const auto &draw : lod)
+				table.put(file_draw{static_cast<std::uint32_t>(draw.count), draw.index_type, static_cast<std::uint64_t>(draw.index_offset), draw.base_vertex, 0});
+
+		for (std::size_t i = 0; i < data.draw_sizes.size(); i++)
+		{
+			table.put(sub_mesh_materials[i]);
+
+			std::vector<float> lod_errors;
+			if (i < data.lods.size())
+				for (const auto &lod : data.lods[i])
+					lod_errors.push_back(lod.error);
+			table.put_array(lod_errors);
+
+			table.put_array(i < data.meshlets.size() ? data.meshlets[i] : std::vector<meshlet>{});
+		}
+
+		table.put<std::uint32_t>(materials.size());
+		for (const auto &mat : materials)
+		{
+			const auto &d = mat->get_data();
+			table.put(file_material{{d.diffuse.x, d.diffuse.y, d.diffuse.z}, d.specular, d.roughness, d.specular_tint, d.two_sided});
+		}
+	};
+
+	auto align = [](std::uint64_t offset)
+	{
+		return (offset + blob_alignment - 1) / blob_alignment * blob_alignment;
+	};
+
+	table_writer sizing;
+	write_table(sizing);
+	std::uint64_t offset = align(sizeof(file_header) + sizing.get_data().size());
+	for (auto &blob : blobs)
+	{
+		blob.offset = offset;
+		offset = align(offset + blob.size);
+	}
+
+	table_writer table;
+	write_table(table);
+
+	file_header header;
+	std::memcpy(header.magic, file_magic, sizeof(file_magic));
+	header.version = file_version;
+	header.table_offset = sizeof(file_header);
+	header.table_size = table.get_data().size();
+
+	std::ofstream f(path.string(), std::ios::binary);
+	if (!f)
+		throw abd::exception("could not open " + path.string() + " for writing");
+
+	auto write_at = [&f](std::uint64_t offset, const void *data, std::size_t size)
+	{
+		f.seekp(offset);
+		f.write(static_cast<const char*>(data), size);
+	};
+
+	write_at(0, &header, sizeof(header));
+	write_at(header.table_offset, table.get_data().data(), table.get_data().size());
+	for (std::size_t i = 0; i < packed.vertex_streams.size(); i++)
+		write_at(blobs[i].offset, packed.vertex_streams[i].data(), blobs[i].size);
+	write_at(blobs.back().offset, packed.indices.data(), blobs.back().size);
+
+	// Pad the file, so the last blob is followed by alignment like every other
+	write_at(offset - 1, "", 1);
+
+	if (!f)
+		throw abd::exception("could not write baked mesh " + path.string());
+}
+
+baked_mesh::baked_mesh(const boost::filesystem::path &path) :
+	m_file(path)
+{
+	if (m_file.size() < sizeof(file_header))
+		throw abd::exception(path.string() + " is not a baked mesh");
+
+	file_header header;
+	std::memcpy(&header, m_file.data(), sizeof(header));
+	if (std::memcmp(header.magic, file_magic, sizeof(file_magic)))
+		throw abd::exception(path.string() + " is not a baked mesh");
+	if (header.version != file_version)
+		throw abd::exception(path.string() + " has unsupported baked mesh version");
+	if (header.table_size > m_file.size() || header.table_offset > m_file.size() - header.table_size)
+		throw abd::exception(path.string() + " is truncated");
+
+	table_reader table(m_file.data() + header.table_offset, m_file.data() + header.table_offset + header.table_size);
+
+	auto layout = table.get<std::uint32_t>();
+	if (layout > static_cast<std::uint32_t>(vertex_layout::COMPACT))
+		throw abd::exception(path.string() + " has invalid vertex layout");
+
+	m_info.layout = static_cast<vertex_layout>(layout);
+	m_info.has_uvs = table.get<std::uint32_t>();
+	m_info.vertex_count = table.get<std::uint64_t>();
+	m_info.quantization = table.get<vertex_quantization>();
+	m_info.bounds = table.get<bounding_sphere>();
+	m_info.lod_errors = table.get_array<float>();
+
+	// Blobs - the last one contains indices
+	auto blobs = table.get_array<file_blob>();
+	if (blobs.size() != abd::get_vertex_layout_strides(m_info.layout).size() + 1)
+		throw abd::exception(path.string() + " has invalid number of vertex streams");
+
+	for (const auto &blob : blobs)
+	{
+		if (blob.size > m_file.size() || blob.offset > m_file.size() - blob.size)
+			throw abd::exception(path.string() + " is truncated");
+		m_vertex_streams.push_back({m_file.data() + blob.offset, static_cast<GLsizeiptr>(blob.size)});
+	}
+
+	m_indices = m_vertex_streams.back();
+	m_vertex_streams.pop_back();
+
+	// Vertex streams must contain exactly vertex_count vertices. Only UVs
+	// in the separate layout are left out if the mesh has none.
+	const auto &strides = abd::get_vertex_layout_strides(m_info.layout);
+	if (m_info.vertex_count < 0)
+		throw abd::exception(path.string() + " has invalid vertex count");
+
+	auto vertex_count = static_cast<std::uint64_t>(m_info.vertex_count);
+	for (std::size_t i = 0; i < strides.size(); i++)
+	{
+		auto stride = static_cast<std::uint64_t>(strides[i]);
+		if (vertex_count > m_file.size() / stride)
+			throw abd::exception(path.string() + " has invalid vertex count");
+
+		auto size = static_cast<std::uint64_t>(m_vertex_streams[i].size);
+		bool optional = m_info.layout == vertex_layout::SEPARATE && i == 2 && !m_info.has_uvs;
+		if (size != vertex_count * stride && !(optional && size == 0))
+			throw abd::exception(path.string() + " has invalid vertex stream size");
+	}
+
+	// Draws
+	auto sub_mesh_count = table.get<std::uint32_t>();
+	auto lod_count = table.get<std::uint32_t>();
+	if (!sub_mesh_count || lod_count != m_info.lod_errors.size())
+		throw abd::exception(path.string() + " has invalid sub-mesh table");
+
+	m_info.draws.resize(lod_count);
+	for (auto &lod : m_info.draws)
+		for (std::uint32_t i = 0; i < sub_mesh_count; i++)
+		{
+			auto d = table.get<file_draw>();
+			if ((d.index_type != GL_UNSIGNED_SHORT && d.index_type != GL_UNSIGNED_INT) || d.count > static_cast<std::uint32_t>(std::numeric_limits<GLsizei>::max()))
+				throw abd::exception(path.string() + " has invalid draw parameters");
+
+			std::uint64_t index_size = d.index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+			auto indices_size = static_cast<std::uint64_t>(m_indices.size);
+			if (d.index_offset % index_size || d.index_offset > indices_size || d.count * index_size > indices_size - d.index_offset)
+				throw abd::exception(path.string() + " has invalid draw parameters");
+
+			// All referenced vertices must exist
+			auto indices = static_cast<const std::byte*>(m_indices.data) + d.index_offset;
+			std::uint64_t max_index = 0;
+			for (std::uint32_t j = 0; j < d.count; j++)
+			{
+				if (d.index_type == GL_UNSIGNED_SHORT)
+				{
+					GLushort index;
+					std::memcpy(&index, indices + j * sizeof(index), sizeof(index));
+					max_index = std::max<std::uint64_t>(max_index, index);
+				}
+				else
+				{
+					GLuint index;
+					std::memcpy(&index, indices + j * sizeof(index), sizeof(index));
+					max_index = std::max<std::uint64_t>(max_index, index);
+				}
+			}
+
+			if (d.base_vertex < 0 || (d.count && static_cast<std::uint64_t>(d.base_vertex) + max_index >= vertex_count))
+				throw abd::exception(path.string() + " has invalid draw parameters");
+
+			lod.push_back({static_cast<GLsizei>(d.count), d.index_type, static_cast<GLintptr>(d.index_offset), d.base_vertex});
+		}
+
+	// Sub-mesh table - base indices as if the indices were stored
+	// one sub-mesh after another, each followed by its LODs
+	std::vector<std::uint32_t> sub_mesh_materials;
+	GLint base_index = 0;
+	m_table.lods.resize(sub_mesh_count);
+	m_table.meshlets.resize(sub_mesh_count);
+	for (std::uint32_t i = 0; i < sub_mesh_count; i++)
+	{
+		const auto &draw = m_info.draws[0][i];
+		m_table.base_indices.push_back(base_index);
+		m_table.base_vertices.push_back(draw.base_vertex);
+		m_table.draw_sizes.push_back(draw.count);
+		base_index += draw.count;
+
+		sub_mesh_materials.push_back(table.get<std::uint32_t>());
+
+		auto lod_errors = table.get_array<float>();
+		if (lod_errors.size() >= lod_count)
+			throw abd::exception(path.string() + " has invalid LOD information");
+
+		for (std::size_t lod = 0; lod < lod_errors.size(); lod++)
+		{
+			const auto &lod_draw = m_info.draws[lod + 1][i];
+			m_table.lods[i].push_back({base_index, lod_draw.count, lod_errors[lod]});
+			base_index += lod_draw.count;
+		}
+
+		m_table.meshlets[i] = table.get_array<meshlet>();
+		for (const auto &m : m_table.meshlets[i])
+			if (m.base_index < 0 || m.draw_size < 0 || static_cast<std::int64_t>(m.base_index) + m.draw_size > draw.count)
+				throw abd::exception(path.string() + " has invalid meshlets");
+	}
+
+	// Materials
+	std::vector<std::shared_ptr<material>> materials;
+	for (auto count = table.get<std::uint32_t>(); count; count--)
+	{
+		auto m = table.get<file_material>();
+		material_data data{};
+		data.diffuse = {m.diffuse[0], m.diffuse[1], m.diffuse[2]};
+		data.specular = m.specular;
+		data.roughness = m.roughness;
+		data.specular_tint = m.specular_tint;
+		data.two_sided = m.two_sided;
+		materials.push_back(std::make_shared<material>(data));
+	}
+
+	for (auto index : sub_mesh_materials)
+	{
+		if (index != no_material && index >= materials.size())
+			throw abd::exception(path.string() + " has invalid material index");
+		m_table.materials.push_back(index == no_material ? nullptr : materials[index]);
+	}
+}
+
+std::shared_ptr<abd::mesh> abd::load_baked_mesh(const boost::filesystem::path &path)
+{
+	baked_mesh baked(path);
+	auto buffers = std::make_unique<mesh_buffers>(baked);
+	return std::make_shared<abd::mesh>(mesh_data{baked.get_table()}, std::move(buffers));
+}
@@ -2,6 +2,7 @@
 
 using abd::perspective;
 using abd::camera;
+using abd::frustum;
 
 perspective::perspective(float fov, float aspect, float near, float far) :
 	m_fov(fov),
@@ -161,3 +162,33 @@ void camera::update_matrix()
 {
 	m_matrix = m_mat_proj * m_mat_view;
 }
+
+
+/**
+	Extracts planes using Gribb-Hartmann method
+*/
+frustum frustum::from_matrix(const glm::mat4 &m)
+{
+	glm::mat4 t = glm::transpose(m);
+	frustum f;
+	f.planes[0] = t[3] + t[0];
+	f.planes[1] = t[3] - t[0];
+	f.planes[2] = t[3] + t[1];
+	f.planes[3] = t[3] - t[1];
+	f.planes[4] = t[3] + t[2];
+	f.planes[5] = t[3] - t[2];
+
+	for (auto &p : f.planes)
+		p /= glm::length(glm::vec3{p});
+
+	return f;
+}
+
+bool frustum::intersects_sphere(const glm::vec3 &center, float radius) const
+{
+	for (const auto &p : planes)
+		if (glm::dot(glm::vec3{p}, center) + p.w < -radius)
+			return false;
+
+	return true;
+}
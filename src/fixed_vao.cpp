@@ -9,19 +9,19 @@ fixed_vao::fixed_vao(const vao_layout &conf) :
 	// Init attributes
 	if (m_layout.attrib_positions.has_value())
 	{
-		m_attrib_positions = this->get_attribute(m_layout.attrib_positions->bindingindex);
+		m_attrib_positions = this->get_attribute(vao_layout::position_index);
 		m_attrib_positions->configure(m_layout.attrib_positions.value());
 	}
 
 	if (m_layout.attrib_normals.has_value())
 	{
-		m_attrib_normals = this->get_attribute(m_layout.attrib_normals->bindingindex);
+		m_attrib_normals = this->get_attribute(vao_layout::normal_index);
 		m_attrib_normals->configure(m_layout.attrib_normals.value());
 	}
 
 	if (m_layout.attrib_uvs.has_value())
 	{
-		m_attrib_uvs = this->get_attribute(m_layout.attrib_uvs->bindingindex);
+		m_attrib_uvs = this->get_attribute(vao_layout::uv_index);
 		m_attrib_uvs->configure(m_layout.attrib_uvs.value());
 	}
 }
@@ -29,4 +29,28 @@ fixed_vao::fixed_vao(const vao_layout &conf) :
 const abd::vao_layout &fixed_vao::get_layout() const
 {
 	return m_layout;
-}
\ No newline at end of file
+}
+
+const std::vector<GLsizei> &abd::get_vertex_layout_strides(vertex_layout layout)
+{
+	static const std::vector<GLsizei> separate_strides = {3 * sizeof(float), 3 * sizeof(float), 2 * sizeof(float)};
+	static const std::vector<GLsizei> interleaved_strides = {sizeof(abd::interleaved_vertex)};
+	static const std::vector<GLsizei> compact_strides = {sizeof(abd::compact_vertex)};
+
+	switch (layout)
+	{
+		case vertex_layout::INTERLEAVED: return interleaved_strides;
+		case vertex_layout::COMPACT: return compact_strides;
+		default: return separate_strides;
+	}
+}
+
+const abd::vao_layout &abd::get_vao_layout(vertex_layout layout)
+{
+	switch (layout)
+	{
+		case vertex_layout::INTERLEAVED: return abd::interleaved_vao_layout;
+		case vertex_layout::COMPACT: return abd::compact_vao_layout;
+		default: return abd::standard_vao_layout;
+	}
+}
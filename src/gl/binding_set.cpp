@@ -0,0 +1,83 @@
+#include <albedo/gl/binding_set.hpp>
+#include <albedo/gl/state_cache.hpp>
+
+using abd::gl::binding_set;
+
+/**
+	Extends the range to include the index if necessary
+*/
+void binding_set::name_range::set(GLuint index, GLuint name)
+{
+	if (names.empty())
+		first = index;
+	else if (index < first)
+	{
+		names.insert(names.begin(), first - index, 0);
+		first = index;
+	}
+
+	if (index - first >= names.size())
+		names.resize(index - first + 1, 0);
+
+	names[index - first] = name;
+}
+
+void binding_set::buffer_range::set(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	GLuint old_first = buffers.first;
+	bool was_empty = buffers.names.empty();
+	buffers.set(index, buffer);
+
+	// Keep offsets and sizes aligned with the buffer names
+	if (!was_empty && buffers.first < old_first)
+	{
+		offsets.insert(offsets.begin(), old_first - buffers.first, 0);
+		sizes.insert(sizes.begin(), old_first - buffers.first, 0);
+	}
+
+	offsets.resize(buffers.names.size(), 0);
+	sizes.resize(buffers.names.size(), 0);
+	offsets[index - buffers.first] = offset;
+	sizes[index - buffers.first] = size;
+}
+
+void binding_set::buffer_range::bind(GLenum target) const
+{
+	if (!buffers.names.empty())
+		glBindBuffersRange(target, buffers.first, buffers.names.size(), buffers.names.data(), offsets.data(), sizes.data());
+}
+
+void binding_set::set_texture(GLuint unit, GLuint texture)
+{
+	m_textures.set(unit, texture);
+}
+
+void binding_set::set_sampler(GLuint unit, GLuint sampler)
+{
+	m_samplers.set(unit, sampler);
+}
+
+void binding_set::set_uniform_buffer(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	m_uniform_buffers.set(index, buffer, offset, size);
+}
+
+void binding_set::set_storage_buffer(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	m_storage_buffers.set(index, buffer, offset, size);
+}
+
+/**
+	Textures go through the state cache, which tracks texture units
+*/
+void binding_set::bind() const
+{
+	if (!m_textures.names.empty())
+		state_cache::get().bind_textures(m_textures.first, m_textures.names.size(), m_textures.names.data());
+
+	if (!m_samplers.names.empty())
+		glBindSamplers(m_samplers.first, m_samplers.names.size(), m_samplers.names.data());
+
+	m_uniform_buffers.bind(GL_UNIFORM_BUFFER);
+	m_storage_buffers.bind(GL_SHADER_STORAGE_BUFFER);
+}
@@ -32,5 +32,5 @@ void buffer::write(GLintptr offset, GLsizeiptr size, const void *data)
 */
 void buffer::read(GLintptr offset, GLsizeiptr size, void *data) const
 {
-	glGetBufferSubData(*this, offset, size, data);
+	glGetNamedBufferSubData(*this, offset, size, data);
 }
@@ -0,0 +1,18 @@
+#include <albedo/gl/buffer_layout.hpp>
+#include <albedo/gl/program.hpp>
+#include <albedo/exception.hpp>
+
+void abd::gl::check_uniform_layout(const program &program, const std::string &prefix, const std::vector<buffer_field> &fields, std::size_t base_offset)
+{
+	const auto &uniforms = program.get_uniforms();
+	for (const auto &field : fields)
+	{
+		auto it = uniforms.find(prefix + field.name);
+		if (it == uniforms.end()) continue;
+
+		auto offset = it->second.get_field_offset(0);
+		if (offset != base_offset + field.offset)
+			throw abd::exception("layout of " + prefix + field.name + " doesn't match - offset is " + std::to_string(offset)
+				+ " instead of " + std::to_string(base_offset + field.offset));
+	}
+}
@@ -0,0 +1,77 @@
+#include <albedo/gl/deferred_program.hpp>
+
+using abd::gl::deferred_program;
+
+bool abd::gl::has_parallel_shader_compile()
+{
+	return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+}
+
+void abd::gl::set_shader_compiler_threads(GLuint count)
+{
+	if (GLEW_KHR_parallel_shader_compile)
+		glMaxShaderCompilerThreadsKHR(count);
+	else if (GLEW_ARB_parallel_shader_compile)
+		glMaxShaderCompilerThreadsARB(count);
+}
+
+/**
+	Submits the program for linking. The shaders must have been
+	created with deferred_compile.
+*/
+deferred_program::deferred_program(std::vector<shader> &&shaders, link_callback on_link) :
+	m_shaders(std::move(shaders)),
+	m_program(new program(m_shaders, deferred_link)),
+	m_on_link(std::move(on_link))
+{
+}
+
+/**
+	Wraps an already linked program
+*/
+deferred_program::deferred_program(program &&linked) :
+	m_program(std::make_unique<program>(std::move(linked))),
+	m_linked(true)
+{
+}
+
+/**
+	Returns true if finish() won't block
+*/
+bool deferred_program::is_ready() const
+{
+	if (m_linked || !has_parallel_shader_compile())
+		return true;
+
+	// GL_COMPLETION_STATUS_ARB has the same value
+	return m_program->get_parameter<GLint>(GL_COMPLETION_STATUS_KHR) == GL_TRUE;
+}
+
+/**
+	Waits for the program to be linked and returns it. Compilation and
+	link errors are thrown as shader_exception. Can only be called once.
+*/
+abd::gl::program deferred_program::finish()
+{
+	if (!m_program)
+		throw abd::exception("deferred_program::finish() called more than once");
+
+	if (!m_linked)
+	{
+		// Report compilation errors rather than the resulting link error
+		if (m_program->get_parameter<GLint>(GL_LINK_STATUS) == GL_FALSE)
+			for (const auto &s : m_shaders)
+				s.check_compile_status();
+
+		m_program->finish_link();
+		m_shaders.clear();
+		m_linked = true;
+
+		if (m_on_link)
+			m_on_link(*m_program);
+	}
+
+	program result = std::move(*m_program);
+	m_program.reset();
+	return result;
+}
@@ -2,6 +2,31 @@
 
 using abd::gl::program;
 
+/**
+	Loads a program from a binary retrieved with get_binary().
+	Throws shader_exception if the driver rejects the binary
+	(e.g. after a driver update).
+*/
+program::program(const program_binary &binary)
+{
+	glProgramBinary(*this, binary.format, binary.data.data(), binary.data.size());
+	finish_link();
+}
+
+/**
+	Throws if linking failed and retrieves uniform information.
+	Blocks until the linking is finished.
+*/
+void program::finish_link()
+{
+	if (this->get_parameter<GLint>(GL_LINK_STATUS) == GL_FALSE)
+	{
+		throw abd::gl::shader_exception(get_link_log(), abd::gl::program_link_error{});
+	}
+
+	init_uniforms();
+}
+
 std::string program::get_link_log() const
 {
 	GLint length = this->get_parameter<GLint>(GL_INFO_LOG_LENGTH);
@@ -14,3 +39,82 @@ std::string program::get_link_log() const
 	else
 		return {};
 }
+
+/**
+	Returns the linked program in a driver-specific format.
+	The result is empty if the driver cannot provide the binary.
+*/
+abd::gl::program_binary program::get_binary() const
+{
+	program_binary binary{0, {}};
+	GLint length = this->get_parameter<GLint>(GL_PROGRAM_BINARY_LENGTH);
+	if (length > 0)
+	{
+		binary.data.resize(length);
+		GLsizei written = 0;
+		glGetProgramBinary(*this, length, &written, &binary.format, binary.data.data());
+		binary.data.resize(written);
+	}
+
+	return binary;
+}
+
+/**
+	Retrieves information about all uniforms and uniform blocks of the linked program
+*/
+void program::init_uniforms()
+{
+	// Get uniform count
+	GLint uniform_count = this->get_parameter<GLint>(GL_ACTIVE_UNIFORMS);
+
+	// Reserve some space for uniform info (SOA style)
+	std::vector<GLuint> uniform_indices(uniform_count);
+	std::vector<GLint> uniform_block_indices(uniform_count);
+	std::vector<GLint> uniform_offsets(uniform_count);
+	std::vector<GLint> uniform_array_strides(uniform_count);
+	std::vector<GLint> uniform_matrix_strides(uniform_count);
+	std::vector<GLint> uniform_is_row_major(uniform_count);
+
+	// Generate indices
+	for (GLint i = 0; i < uniform_count; i++)
+		uniform_indices.at(i) = i;
+
+	// Get uniform data
+	glGetActiveUniformsiv(*this, uniform_count, uniform_indices.data(), GL_UNIFORM_BLOCK_INDEX, uniform_block_indices.data());
+	glGetActiveUniformsiv(*this, uniform_count, uniform_indices.data(), GL_UNIFORM_OFFSET, uniform_offsets.data());
+	glGetActiveUniformsiv(*this, uniform_count, uniform_indices.data(), GL_UNIFORM_ARRAY_STRIDE, uniform_array_strides.data());
+	glGetActiveUniformsiv(*this, uniform_count, uniform_indices.data(), GL_UNIFORM_MATRIX_STRIDE, uniform_matrix_strides.data());
+	glGetActiveUniformsiv(*this, uniform_count, uniform_indices.data(), GL_UNIFORM_IS_ROW_MAJOR, uniform_is_row_major.data());
+
+	// Construct uniforms (AOS style)
+	for (GLint i = 0; i < uniform_count; i++)
+	{
+		char name[1024];
+		GLenum type;
+		GLint size;
+		GLint location;
+		glGetActiveUniform(*this, i, sizeof(name), nullptr, &size, &type, name);
+		location = glGetUniformLocation(*this, name);
+
+		m_uniforms.emplace(name, uniform{
+			*this,
+			location,
+			type,
+			size,
+			uniform_block_indices.at(i),
+			uniform_offsets.at(i),
+			uniform_array_strides.at(i),
+			uniform_matrix_strides.at(i),
+			uniform_is_row_major.at(i)
+		});
+	}
+
+	// Retrieve uniform block information
+	GLint uniform_block_count = this->get_parameter<GLint>(GL_ACTIVE_UNIFORM_BLOCKS);
+	for (GLint i = 0; i < uniform_block_count; i++)
+	{
+		char name[1024];
+		glGetActiveUniformBlockName(*this, i, sizeof(name), nullptr, name);
+		m_uniform_blocks.emplace(name, uniform_block{*this, static_cast<GLuint>(i)});
+	}
+}
@@ -2,12 +2,32 @@
 
 using abd::gl::shader;
 
+bool abd::gl::has_spirv_support()
+{
+	return GLEW_VERSION_4_6 || GLEW_ARB_gl_spirv;
+}
+
 shader::shader(GLenum shader_type, const std::string &src) :
 	shader(shader_type, src.c_str())
 {
 }
 
 shader::shader(GLenum shader_type, const char *src) :
+	shader(shader_type, src, deferred_compile)
+{
+	check_compile_status();
+}
+
+shader::shader(GLenum shader_type, const std::string &src, deferred_compile_t) :
+	shader(shader_type, src.c_str(), deferred_compile)
+{
+}
+
+/**
+	Submits the source for compilation, but doesn't query the result,
+	so the driver can compile the shader in the background
+*/
+shader::shader(GLenum shader_type, const char *src, deferred_compile_t) :
 	gl_object<abd::gl::gl_object_type::SHADER>(shader_type)
 {
 	// Provide source code
@@ -15,8 +35,48 @@ shader::shader(GLenum shader_type, const char *src) :
 
 	// Compile the shader
 	glCompileShader(*this);
+}
+
+/**
+	Creates the shader from a SPIR-V module (entry point "main") and
+	specializes it with the constants
+*/
+shader::shader(GLenum shader_type, const void *spirv, std::size_t size, const std::vector<specialization_constant> &constants) :
+	shader(shader_type, spirv, size, constants, deferred_compile)
+{
+	check_compile_status();
+}
+
+/**
+	Same as above, but doesn't query the result of specialization
+	(see the deferred source constructor)
+*/
+shader::shader(GLenum shader_type, const void *spirv, std::size_t size, const std::vector<specialization_constant> &constants, deferred_compile_t) :
+	gl_object<abd::gl::gl_object_type::SHADER>(shader_type)
+{
+	GLuint id = *this;
+	glShaderBinary(1, &id, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, spirv, size);
+
+	std::vector<GLuint> indices, values;
+	for (const auto &c : constants)
+	{
+		indices.push_back(c.id);
+		values.push_back(c.value);
+	}
+
+	// Specialization replaces compilation for SPIR-V shaders
+	if (GLEW_VERSION_4_6)
+		glSpecializeShader(*this, "main", constants.size(), indices.data(), values.data());
+	else
+		glSpecializeShaderARB(*this, "main", constants.size(), indices.data(), values.data());
+}
 
-	// Throw compilation exception if failed to compile
+/**
+	Throws compilation exception if the shader failed to compile.
+	Blocks until the compilation is finished.
+*/
+void shader::check_compile_status() const
+{
 	if (this->get_parameter<GLint>(GL_COMPILE_STATUS) == GL_FALSE)
 	{
 		throw abd::gl::shader_exception(this->get_compile_log());
@@ -34,4 +94,4 @@ std::string shader::get_compile_log() const
 	}
 	else
 		return {};
-}
\ No newline at end of file
+}
@@ -0,0 +1,158 @@
+#include <albedo/gl/state_cache.hpp>
+
+using abd::gl::state_cache;
+
+state_cache &state_cache::get()
+{
+	thread_local state_cache cache;
+	return cache;
+}
+
+void state_cache::enable(GLenum capability)
+{
+	m_stats.calls++;
+	auto it = m_capabilities.find(capability);
+	if (it != m_capabilities.end() && it->second)
+	{
+		m_stats.filtered++;
+		return;
+	}
+
+	m_capabilities[capability] = true;
+	glEnable(capability);
+}
+
+void state_cache::disable(GLenum capability)
+{
+	m_stats.calls++;
+	auto it = m_capabilities.find(capability);
+	if (it != m_capabilities.end() && !it->second)
+	{
+		m_stats.filtered++;
+		return;
+	}
+
+	m_capabilities[capability] = false;
+	glDisable(capability);
+}
+
+void state_cache::depth_mask(GLboolean flag)
+{
+	if (update(m_depth_mask, flag))
+		glDepthMask(flag);
+}
+
+void state_cache::depth_func(GLenum func)
+{
+	if (update(m_depth_func, func))
+		glDepthFunc(func);
+}
+
+void state_cache::blend_func(GLenum sfactor, GLenum dfactor)
+{
+	if (update(m_blend_func, std::make_pair(sfactor, dfactor)))
+		glBlendFunc(sfactor, dfactor);
+}
+
+void state_cache::blend_equation(GLenum mode)
+{
+	if (update(m_blend_equation, mode))
+		glBlendEquation(mode);
+}
+
+/**
+	GL_FRAMEBUFFER binds both the draw and the read framebuffer
+*/
+void state_cache::bind_framebuffer(GLenum target, GLuint framebuffer)
+{
+	if (target == GL_FRAMEBUFFER)
+	{
+		bool draw_changed = update(m_draw_framebuffer, framebuffer);
+		bool read_changed = update(m_read_framebuffer, framebuffer);
+		if (draw_changed && read_changed)
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		else if (draw_changed)
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+		else if (read_changed)
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	}
+	else if (update(target == GL_DRAW_FRAMEBUFFER ? m_draw_framebuffer : m_read_framebuffer, framebuffer))
+		glBindFramebuffer(target, framebuffer);
+}
+
+void state_cache::use_program(GLuint program)
+{
+	if (update(m_program, program))
+		glUseProgram(program);
+}
+
+void state_cache::bind_vertex_array(GLuint vertex_array)
+{
+	if (update(m_vertex_array, vertex_array))
+		glBindVertexArray(vertex_array);
+}
+
+void state_cache::bind_texture_unit(GLuint unit, GLuint texture)
+{
+	if (unit >= m_texture_units.size())
+		m_texture_units.resize(unit + 1);
+
+	if (update(m_texture_units[unit], texture))
+		glBindTextureUnit(unit, texture);
+}
+
+/**
+	Binds all textures with a single call, unless none of the units changes
+*/
+void state_cache::bind_textures(GLuint first, GLsizei count, const GLuint *textures)
+{
+	if (first + count > m_texture_units.size())
+		m_texture_units.resize(first + count);
+
+	bool changed = false;
+	for (GLsizei i = 0; i < count; i++)
+		changed |= update(m_texture_units[first + i], textures[i]);
+
+	if (changed)
+		glBindTextures(first, count, textures);
+}
+
+void state_cache::forget_framebuffer(GLuint framebuffer)
+{
+	if (m_draw_framebuffer == framebuffer) m_draw_framebuffer.reset();
+	if (m_read_framebuffer == framebuffer) m_read_framebuffer.reset();
+}
+
+void state_cache::forget_program(GLuint program)
+{
+	if (m_program == program) m_program.reset();
+}
+
+void state_cache::forget_vertex_array(GLuint vertex_array)
+{
+	if (m_vertex_array == vertex_array) m_vertex_array.reset();
+}
+
+void state_cache::forget_texture(GLuint texture)
+{
+	for (auto &unit : m_texture_units)
+		if (unit == texture)
+			unit.reset();
+}
+
+/**
+	Marks all state as unknown, so the next calls are never dropped
+*/
+void state_cache::invalidate()
+{
+	m_capabilities.clear();
+	m_depth_mask.reset();
+	m_depth_func.reset();
+	m_blend_func.reset();
+	m_blend_equation.reset();
+	m_draw_framebuffer.reset();
+	m_read_framebuffer.reset();
+	m_program.reset();
+	m_vertex_array.reset();
+	m_texture_units.clear();
+}
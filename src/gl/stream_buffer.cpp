@@ -0,0 +1,160 @@
+#include <albedo/gl/stream_buffer.hpp>
+#include <algorithm>
+
+using abd::gl::stream_buffer;
+using abd::gl::stream_allocation;
+
+/**
+	Frame size is rounded up so that all chunks begin at offsets
+	satisfying all alignment requirements
+*/
+stream_buffer::stream_buffer(GLsizeiptr frame_size, int frame_count) :
+	m_synced_buffer(align_frame_size(frame_size), GL_MAP_WRITE_BIT, frame_count)
+{
+}
+
+/**
+	Acquires a new chunk for the frame. Blocks if the GPU
+	is still using it.
+*/
+void stream_buffer::begin_frame()
+{
+	if (m_chunk)
+		throw abd::exception("stream_buffer::begin_frame() called twice without end_frame()");
+
+	m_chunk = m_synced_buffer.get_chunk();
+	m_used = 0;
+	m_flushed = 0;
+}
+
+/**
+	Non-blocking version of begin_frame(). Returns false if
+	no chunk was available.
+*/
+bool stream_buffer::try_begin_frame()
+{
+	if (m_chunk)
+		throw abd::exception("stream_buffer::try_begin_frame() called twice without end_frame()");
+
+	m_chunk = m_synced_buffer.try_get_chunk();
+	m_used = 0;
+	m_flushed = 0;
+	return m_chunk.has_value();
+}
+
+/**
+	Flushes all memory allocated since the last flush, making
+	the writes visible to the GPU.
+*/
+void stream_buffer::flush()
+{
+	if (!m_chunk)
+		throw abd::exception("stream_buffer::flush() called outside of a frame");
+
+	if (m_used > m_flushed)
+		m_chunk->flush(m_flushed, m_used - m_flushed);
+	m_flushed = m_used;
+}
+
+/**
+	Flushes only the specified allocation. Useful when other allocations
+	may still be written to (e.g. by other threads).
+*/
+void stream_buffer::flush(const stream_allocation &allocation)
+{
+	if (!m_chunk)
+		throw abd::exception("stream_buffer::flush() called outside of a frame");
+
+	if (allocation.size > 0)
+		m_chunk->flush(allocation.offset - m_chunk->get_offset(), allocation.size);
+}
+
+/**
+	Flushes all remaining memory allocated in this frame and
+	fences the chunk.
+*/
+void stream_buffer::end_frame()
+{
+	flush();
+	m_chunk->fence();
+	m_chunk.reset();
+}
+
+/**
+	Allocates a region of memory with specified alignment (relative to the
+	buffer's beginning). Alignment must be a power of two.
+*/
+stream_allocation stream_buffer::allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+	if (!m_chunk)
+		throw abd::exception("stream_buffer::allocate() called outside of a frame");
+
+	// Chunk offsets are aligned, so the offset within the chunk can be aligned instead
+	GLsizeiptr offset = (m_used + alignment - 1) & ~(alignment - 1);
+	if (offset + size > m_chunk->get_size())
+		throw abd::exception("stream_buffer ran out of memory for the current frame");
+
+	m_used = offset + size;
+
+	return stream_allocation{
+		static_cast<char*>(m_chunk->get_ptr()) + offset,
+		m_chunk->get_offset() + offset,
+		size,
+		&m_chunk->get_buffer()
+	};
+}
+
+/**
+	Allocates a region suitable for binding with glBindBufferRange(GL_UNIFORM_BUFFER, ...)
+*/
+stream_allocation stream_buffer::allocate_uniform(GLsizeiptr size)
+{
+	return allocate(size, get_uniform_alignment());
+}
+
+/**
+	Allocates a region suitable for binding with glBindBufferRange(GL_SHADER_STORAGE_BUFFER, ...)
+*/
+stream_allocation stream_buffer::allocate_storage(GLsizeiptr size)
+{
+	return allocate(size, get_storage_alignment());
+}
+
+/**
+	Returns GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT (queried only once)
+*/
+GLsizeiptr stream_buffer::get_uniform_alignment()
+{
+	static const GLsizeiptr alignment = []()
+	{
+		GLint value;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+		return value;
+	}();
+	return alignment;
+}
+
+/**
+	Returns GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT (queried only once)
+*/
+GLsizeiptr stream_buffer::get_storage_alignment()
+{
+	static const GLsizeiptr alignment = []()
+	{
+		GLint value;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &value);
+		return value;
+	}();
+	return alignment;
+}
+
+/**
+	Rounds frame size up to a multiple of the largest alignment requirement.
+	All of the alignments are powers of two, so the largest one is divisible
+	by all others.
+*/
+GLsizeiptr stream_buffer::align_frame_size(GLsizeiptr size)
+{
+	GLsizeiptr alignment = std::max<GLsizeiptr>({get_uniform_alignment(), get_storage_alignment(), 256});
+	return (size + alignment - 1) / alignment * alignment;
+}
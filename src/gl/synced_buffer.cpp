@@ -1,34 +1,114 @@
 #include <albedo/gl/synced_buffer.hpp>
+#include <algorithm>
 
 using abd::gl::synced_buffer;
 
 synced_buffer::synced_buffer(GLsizeiptr chunk_size, GLbitfield flags, int chunk_count) :
 	m_chunk_size(chunk_size),
-	m_chunk_count(chunk_count),
-	m_buffer(chunk_size * chunk_count, nullptr, flags | GL_MAP_PERSISTENT_BIT),
-	m_fences(chunk_count)
+	m_flags(flags)
 {
-	if (flags & GL_MAP_WRITE_BIT) flags |= GL_MAP_FLUSH_EXPLICIT_BIT;
-	m_map_ptr = glMapNamedBufferRange(m_buffer, 0, chunk_size * chunk_count, flags | GL_MAP_PERSISTENT_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
-	if (m_map_ptr == nullptr)
-		throw abd::exception("abd::gl::synced_buffer failed to map the buffer");
+	add_segment(chunk_count);
 }
 
 synced_buffer::~synced_buffer()
 {
-	glUnmapNamedBuffer(m_buffer);
+	for (auto &seg : m_segments)
+		glUnmapNamedBuffer(seg.buffer);
 }
 
+/**
+	Returns the next chunk. If the GPU is still using it, either grows the
+	ring (if allowed to) or blocks until the chunk is free.
+*/
 abd::gl::synced_buffer_handle synced_buffer::get_chunk()
 {
-	// Wait for the fence (and implicitly destroy it)
-	m_fences[m_current_chunk].wait();
+	// Poll the fence (and implicitly destroy it if signaled)
+	auto &fence = m_chunks[m_ring[m_ring_position]].fence;
+	if (!fence.wait(0))
+	{
+		m_stats.stalls++;
+		if (grow())
+			return take_current_chunk();
+
+		// Wait until the fence signals - never hand out memory that is in use
+		auto wait_begin = std::chrono::steady_clock::now();
+		while (!fence.wait(m_wait_timeout))
+			m_stats.timeouts++;
+
+		auto wait_time = std::chrono::steady_clock::now() - wait_begin;
+		m_stats.total_wait_time += wait_time;
+		m_stats.max_wait_time = std::max<std::chrono::nanoseconds>(m_stats.max_wait_time, wait_time);
+	}
+
+	return take_current_chunk();
+}
+
+/**
+	Returns the next chunk only if it is not in use by the GPU (or if the
+	ring could grow). Never blocks.
+*/
+std::optional<abd::gl::synced_buffer_handle> synced_buffer::try_get_chunk()
+{
+	auto &fence = m_chunks[m_ring[m_ring_position]].fence;
+	if (!fence.wait(0))
+	{
+		m_stats.stalls++;
+		if (!grow())
+		{
+			m_stats.failed_acquisitions++;
+			return {};
+		}
+	}
 
-	// Create a handle
-	synced_buffer_handle handle(this, m_current_chunk);
+	return take_current_chunk();
+}
 
-	// Increment chunk id
-	m_current_chunk = (m_current_chunk + 1) % m_chunk_count;
+/**
+	Creates a new persistently mapped buffer containing chunk_count chunks.
+	The chunks are appended at the end of the ring.
+*/
+void synced_buffer::add_segment(int chunk_count)
+{
+	GLbitfield map_flags = m_flags | GL_MAP_PERSISTENT_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+	if (m_flags & GL_MAP_WRITE_BIT) map_flags |= GL_MAP_FLUSH_EXPLICIT_BIT;
 
+	gl::buffer buffer(m_chunk_size * chunk_count, nullptr, m_flags | GL_MAP_PERSISTENT_BIT);
+	void *map_ptr = glMapNamedBufferRange(buffer, 0, m_chunk_size * chunk_count, map_flags);
+	if (map_ptr == nullptr)
+		throw abd::exception("abd::gl::synced_buffer failed to map the buffer");
+
+	m_segments.push_back(segment{std::move(buffer), map_ptr});
+	for (int i = 0; i < chunk_count; i++)
+	{
+		m_ring.push_back(m_chunks.size());
+		m_chunks.push_back(chunk{static_cast<int>(m_segments.size()) - 1, m_chunk_size * i, {}});
+	}
+}
+
+/**
+	Inserts a new chunk into the ring just before the current (busy) one,
+	so the busy chunk remains the next one to be reused.
+	Returns false if growth is not allowed.
+*/
+bool synced_buffer::grow()
+{
+	if (get_chunk_count() >= m_max_chunk_count)
+		return false;
+
+	add_segment(1);
+	m_ring.pop_back();
+	m_ring.insert(m_ring.begin() + m_ring_position, m_chunks.size() - 1);
+	m_stats.grows++;
+	return true;
+}
+
+/**
+	Returns a handle to the current chunk and advances in the ring
+*/
+abd::gl::synced_buffer_handle synced_buffer::take_current_chunk()
+{
+	synced_buffer_handle handle(this, m_ring[m_ring_position]);
+	m_ring_position = (m_ring_position + 1) % m_ring.size();
+	m_stats.acquisitions++;
 	return handle;
-}
\ No newline at end of file
+}
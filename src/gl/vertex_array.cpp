@@ -1,4 +1,5 @@
 #include <albedo/gl/vertex_array.hpp>
+#include <albedo/gl/state_cache.hpp>
 #include <albedo/exception.hpp>
 #include <algorithm>
 
@@ -37,7 +38,7 @@ void vertex_array::set_attribute_enable(GLuint attribindex, bool enable)
 
 void vertex_array::bind() const
 {
-	glBindVertexArray(*this);
+	state_cache::get().bind_vertex_array(*this);
 }
 
 /**
@@ -97,6 +97,7 @@ std::vector<window::hint> window_builder::to_hints() const
 		{GLFW_CONTEXT_VERSION_MINOR, m_minor},
 		{GLFW_OPENGL_PROFILE, m_profile},
 		{GLFW_SAMPLES, m_samples},
+		{GLFW_VISIBLE, m_visible},
 	};
 }
 
@@ -0,0 +1,46 @@
+#include <albedo/mapped_file.hpp>
+#include <albedo/exception.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using abd::mapped_file;
+
+mapped_file::mapped_file(const boost::filesystem::path &path)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw abd::exception("could not open file " + path.string());
+
+	struct stat st;
+	if (fstat(fd, &st) < 0)
+	{
+		close(fd);
+		throw abd::exception("could not stat file " + path.string());
+	}
+
+	m_size = st.st_size;
+	if (m_size)
+	{
+		void *ptr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (ptr == MAP_FAILED)
+		{
+			close(fd);
+			throw abd::exception("could not map file " + path.string());
+		}
+
+		// The whole file is going to be read soon
+		madvise(ptr, m_size, MADV_WILLNEED);
+		m_data = static_cast<std::byte*>(ptr);
+	}
+
+	// The mapping remains valid after the descriptor is closed
+	close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+	if (m_data)
+		munmap(m_data, m_size);
+}
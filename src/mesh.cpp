@@ -1,43 +1,609 @@
 #include <albedo/mesh.hpp>
+#include <albedo/mesh_arena.hpp>
+#include <albedo/baked_mesh.hpp>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 using abd::mesh_data;
 using abd::mesh_buffers;
 
 /**
-	Buffers data provided in the mesh_data or compound_mesh_data in GPU.
+	Computes a sphere centered in the middle of the bounding box
 */
-mesh_buffers::mesh_buffers(const mesh_data &data)
+abd::bounding_sphere abd::bounding_sphere::from_positions(const std::vector<glm::vec3> &positions)
 {
-	const GLbitfield flags = GL_DYNAMIC_STORAGE_BIT;
+	bounding_sphere sphere;
+	if (positions.empty()) return sphere;
+
+	glm::vec3 min = positions[0], max = positions[0];
+	for (const auto &p : positions)
+	{
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+
+	sphere.center = (min + max) * 0.5f;
+	for (const auto &p : positions)
+		sphere.radius = std::max(sphere.radius, glm::length(p - sphere.center));
+
+	return sphere;
+}
 
+template <typename T>
+static std::vector<std::byte> to_bytes(const std::vector<T> &v)
+{
+	auto ptr = reinterpret_cast<const std::byte*>(v.data());
+	return std::vector<std::byte>(ptr, ptr + v.size() * sizeof(T));
+}
+
+/**
+	Packs vertex data into a single buffer of Format::vertex structures.
+	Missing UVs are left zeroed.
+*/
+template <typename Format>
+static std::vector<std::byte> pack_interleaved(const mesh_data &data, const abd::vertex_quantization &q)
+{
+	std::vector<typename Format::vertex> vertices;
+	vertices.reserve(data.positions.size());
+	for (std::size_t i = 0; i < data.positions.size(); i++)
+		vertices.push_back(Format::pack(data.positions[i], data.normals[i], data.uvs.empty() ? glm::vec2{0.f} : data.uvs[i], q));
+
+	return to_bytes(vertices);
+}
+
+/**
+	Packs vertex data into streams according to the layout.
+	Stream i is meant to be bound at VAO binding i. Streams
+	for missing attributes are left empty.
+*/
+static std::vector<std::vector<std::byte>> pack_vertex_streams(const mesh_data &data, abd::vertex_layout layout, const abd::vertex_quantization &q)
+{
+	switch (layout)
+	{
+		case abd::vertex_layout::INTERLEAVED:
+			return {pack_interleaved<abd::interleaved_vertex_format>(data, q)};
+
+		case abd::vertex_layout::COMPACT:
+			return {pack_interleaved<abd::compact_vertex_format>(data, q)};
+
+		default:
+			return {to_bytes(data.positions), to_bytes(data.normals), to_bytes(data.uvs)};
+	}
+}
+
+/**
+	Appends a range of indices using the smallest sufficient type.
+	Ranges referencing fewer than 65536 vertices use GLushort indices.
+	Each range begins at a 4-byte aligned offset.
+*/
+static abd::sub_mesh_draw pack_index_range(std::vector<std::byte> &packed, const GLuint *begin, const GLuint *end)
+{
+	GLuint max_index = begin != end ? *std::max_element(begin, end) : 0;
+	bool use_short = max_index <= std::numeric_limits<GLushort>::max();
+
+	abd::sub_mesh_draw draw;
+	draw.count = end - begin;
+	draw.index_type = use_short ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	draw.index_offset = (packed.size() + sizeof(GLuint) - 1) / sizeof(GLuint) * sizeof(GLuint);
+	draw.base_vertex = 0;
+
+	std::size_t index_size = use_short ? sizeof(GLushort) : sizeof(GLuint);
+	packed.resize(draw.index_offset + draw.count * index_size);
+	std::byte *ptr = packed.data() + draw.index_offset;
+	for (auto it = begin; it != end; ++it, ptr += index_size)
+	{
+		if (use_short)
+		{
+			GLushort index = *it;
+			std::memcpy(ptr, &index, sizeof(index));
+		}
+		else
+			std::memcpy(ptr, it, sizeof(GLuint));
+	}
+
+	return draw;
+}
+
+/**
+	Packs indices of every sub-mesh and all its LODs. Sub-meshes with fewer
+	LODs than others use their least detailed version at the remaining levels.
+*/
+static void pack_indices(const mesh_data &data, abd::packed_mesh &packed)
+{
+	std::size_t lod_count = 1;
+	for (const auto &lods : data.lods)
+		lod_count = std::max(lod_count, lods.size() + 1);
+
+	packed.info.draws.assign(lod_count, {});
+	packed.info.lod_errors.assign(lod_count, 0.f);
+
+	for (std::size_t i = 0; i < data.draw_sizes.size(); i++)
+	{
+		GLint base_vertex = data.base_vertices.empty() ? 0 : data.base_vertices[i];
+		const GLuint *indices = data.indices.data();
+
+		abd::sub_mesh_draw draw = pack_index_range(packed.indices, indices + data.base_indices[i], indices + data.base_indices[i] + data.draw_sizes[i]);
+		draw.base_vertex = base_vertex;
+		packed.info.draws[0].push_back(draw);
+
+		for (std::size_t lod = 1; lod < lod_count; lod++)
+		{
+			if (i < data.lods.size() && lod - 1 < data.lods[i].size())
+			{
+				const auto &l = data.lods[i][lod - 1];
+				draw = pack_index_range(packed.indices, indices + l.base_index, indices + l.base_index + l.draw_size);
+				draw.base_vertex = base_vertex;
+				packed.info.lod_errors[lod] = std::max(packed.info.lod_errors[lod], l.error);
+			}
+
+			packed.info.draws[lod].push_back(draw);
+		}
+	}
+
+	// Errors must not decrease with LOD level
+	for (std::size_t lod = 1; lod < lod_count; lod++)
+		packed.info.lod_errors[lod] = std::max(packed.info.lod_errors[lod], packed.info.lod_errors[lod - 1]);
+}
+
+static void validate_mesh_data(const mesh_data &data)
+{
 	// Do not allow any mesh that is incomplete
 	if (!data.indices.size() || !data.positions.size() || !data.normals.size())
 		throw abd::exception("cannot greate mesh_buffers from icomplete mesh data");
 
-	m_index_buffer = abd::gl::vector_to_buffer(data.indices, flags);
-	m_position_buffer = abd::gl::vector_to_buffer(data.positions, flags);
-	m_normal_buffer = abd::gl::vector_to_buffer(data.normals, flags);
-	if (!data.uvs.empty()) m_uv_buffer = abd::gl::vector_to_buffer(data.uvs, flags);			
+	// Every vertex needs a normal and either all or none of the vertices have UVs
+	if (data.normals.size() != data.positions.size() || (!data.uvs.empty() && data.uvs.size() != data.positions.size()))
+		throw abd::exception("mesh data contains vertices with missing attributes");
+
+	if (data.draw_sizes.empty() || data.draw_sizes.size() != data.base_indices.size())
+		throw abd::exception("mesh data contains invalid sub-mesh information");
+
+	if (!data.lods.empty() && data.lods.size() != data.draw_sizes.size())
+		throw abd::exception("mesh data contains invalid LOD information");
+
+	if (!data.meshlets.empty() && data.meshlets.size() != data.draw_sizes.size())
+		throw abd::exception("mesh data contains invalid meshlet information");
+}
+
+/**
+	Packs vertex and index data into the format used by mesh_buffers
+*/
+abd::packed_mesh abd::pack_mesh(const mesh_data &data, vertex_layout layout)
+{
+	validate_mesh_data(data);
+
+	packed_mesh packed;
+	auto &info = packed.info;
+	info.layout = layout;
+	info.vertex_count = data.positions.size();
+	info.has_uvs = !data.uvs.empty();
+	info.bounds = abd::bounding_sphere::from_positions(data.positions);
+
+	if (abd::has_quantized_positions(layout))
+		info.quantization = vertex_quantization::from_positions(data.positions);
+
+	packed.vertex_streams = pack_vertex_streams(data, layout, info.quantization);
+	pack_indices(data, packed);
+	return packed;
+}
+
+/**
+	Buffers data provided in the mesh_data or compound_mesh_data in GPU.
+*/
+mesh_buffers::mesh_buffers(const mesh_data &data, vertex_layout layout) :
+	mesh_buffers(data, [](const void *ptr, GLsizeiptr size, GLbitfield flags)
+	{
+		return std::make_unique<abd::gl::buffer>(size, ptr, flags);
+	}, layout)
+{
+}
+
+/**
+	Buffers data in GPU using the provided upload function
+*/
+mesh_buffers::mesh_buffers(const mesh_data &data, const buffer_upload_func &upload, vertex_layout layout) :
+	mesh_buffers(abd::pack_mesh(data, layout), data.meshlets, upload)
+{
+}
+
+/**
+	Buffers data that has already been packed (e.g. on another thread)
+*/
+mesh_buffers::mesh_buffers(const packed_mesh &packed, const std::vector<std::vector<meshlet>> &meshlets) :
+	mesh_buffers(packed, meshlets, [](const void *ptr, GLsizeiptr size, GLbitfield flags)
+	{
+		return std::make_unique<abd::gl::buffer>(size, ptr, flags);
+	})
+{
+}
+
+/**
+	Buffers packed data using the provided upload function
+*/
+mesh_buffers::mesh_buffers(const packed_mesh &packed, const std::vector<std::vector<meshlet>> &meshlets, const buffer_upload_func &upload)
+{
+	const GLbitfield flags = GL_DYNAMIC_STORAGE_BIT;
+	init_info(packed.info, meshlets);
+
+	m_index_buffer = upload(packed.indices.data(), packed.indices.size(), flags);
+	for (const auto &stream : packed.vertex_streams)
+		m_vertex_buffers.push_back(stream.empty() ? nullptr : upload(stream.data(), stream.size(), flags));
+
+	m_resident_lods.assign(packed.info.draws.at(0).size(), 0);
+	init_draws(packed.info.draws, 0, 0);
+}
+
+/**
+	Places the data in the shared mesh_arena. The vertex layout is
+	determined by the arena.
+*/
+mesh_buffers::mesh_buffers(const mesh_data &data, std::shared_ptr<mesh_arena> arena)
+{
+	auto packed = abd::pack_mesh(data, arena->get_vertex_layout());
+	init_info(packed.info, data.meshlets);
+
+	GLsizeiptr index_size = packed.indices.size();
+	m_arena_allocation = arena->allocate(m_vertex_count, index_size);
+
+	for (std::size_t i = 0; i < packed.vertex_streams.size(); i++)
+		if (!packed.vertex_streams[i].empty())
+			arena->write_vertices(i, m_arena_allocation->get_base_vertex(), m_vertex_count, packed.vertex_streams[i].data());
+	arena->write_indices(m_arena_allocation->get_index_offset(), index_size, packed.indices.data());
+
+	m_resident_lods.assign(data.draw_sizes.size(), 0);
+	init_draws(packed.info.draws, m_arena_allocation->get_base_vertex(), m_arena_allocation->get_index_offset());
+}
+
+/**
+	Allocates buffers, but doesn't upload any data. Nothing can be
+	drawn until the data is streamed (see stream()).
+*/
+mesh_buffers::mesh_buffers(const mesh_data &data, vertex_layout layout, deferred_upload_t)
+{
+	const GLbitfield flags = GL_DYNAMIC_STORAGE_BIT;
+	auto packed = abd::pack_mesh(data, layout);
+	init_info(packed.info, data.meshlets);
+
+	m_index_buffer = std::make_unique<abd::gl::buffer>(packed.indices.size(), nullptr, flags);
+	for (const auto &stream : packed.vertex_streams)
+		m_vertex_buffers.push_back(stream.empty() ? nullptr : std::make_unique<abd::gl::buffer>(stream.size(), nullptr, flags));
+
+	init_draws(packed.info.draws, 0, 0);
+	init_streaming(data, std::move(packed));
+}
+
+/**
+	Allocates space in the arena, but doesn't upload any data
+*/
+mesh_buffers::mesh_buffers(const mesh_data &data, std::shared_ptr<mesh_arena> arena, deferred_upload_t)
+{
+	auto packed = abd::pack_mesh(data, arena->get_vertex_layout());
+	init_info(packed.info, data.meshlets);
+	m_arena_allocation = arena->allocate(m_vertex_count, packed.indices.size());
+
+	init_draws(packed.info.draws, m_arena_allocation->get_base_vertex(), m_arena_allocation->get_index_offset());
+	init_streaming(data, std::move(packed));
+}
+
+/**
+	Creates buffers directly from data of a baked mesh. The data is passed
+	to the GL straight from the mapped file - no copies are made.
+*/
+mesh_buffers::mesh_buffers(const baked_mesh &baked)
+{
+	const GLbitfield flags = 0;
+	init_info(baked.get_info(), baked.get_meshlets());
+
+	auto indices = baked.get_indices();
+	m_index_buffer = std::make_unique<abd::gl::buffer>(indices.size, indices.data, flags);
+	for (const auto &stream : baked.get_vertex_streams())
+		m_vertex_buffers.push_back(stream.size ? std::make_unique<abd::gl::buffer>(stream.size, stream.data, flags) : nullptr);
+
+	m_resident_lods.assign(baked.get_sub_mesh_count(), 0);
+	init_draws(baked.get_info().draws, 0, 0);
+}
+
+/**
+	Copies properties of the packed data (except for the draws)
+*/
+void mesh_buffers::init_info(const packed_mesh_info &info, const std::vector<std::vector<meshlet>> &meshlets)
+{
+	m_vertex_layout = info.layout;
+	m_quantization = info.quantization;
+	m_vertex_count = info.vertex_count;
+	m_has_uvs = info.has_uvs;
+	m_bounding_sphere = info.bounds;
+	m_lod_errors = info.lod_errors;
+	m_meshlets = meshlets;
+}
+
+/**
+	Prepares the upload order. For every sub-mesh, its vertices and the least
+	detailed LOD come first, so the whole mesh becomes drawable as soon as
+	possible. More detailed LODs follow, level by level.
+*/
+void mesh_buffers::init_streaming(const mesh_data &data, packed_mesh &&packed)
+{
+	m_resident_lods.assign(data.draw_sizes.size(), -1);
+
+	auto state = std::make_unique<streaming_state>();
+	const auto &strides = abd::get_vertex_layout_strides(m_vertex_layout);
+
+	auto lod_count = [&data](std::size_t i) -> int
+	{
+		return 1 + (i < data.lods.size() ? data.lods[i].size() : 0);
+	};
+
+	auto index_unit = [&packed](std::size_t i, int lod) -> upload_unit
+	{
+		const auto &draw = packed.info.draws[lod][i];
+		GLsizeiptr index_size = draw.index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+		return {-1, draw.index_offset, draw.count * index_size, static_cast<int>(i), lod, true};
+	};
+
+	// Sorted base vertices - vertex ranges of the sub-meshes
+	std::vector<GLint> base_vertices(data.base_vertices.begin(), data.base_vertices.end());
+	if (base_vertices.empty()) base_vertices.push_back(0);
+	std::sort(base_vertices.begin(), base_vertices.end());
+	base_vertices.erase(std::unique(base_vertices.begin(), base_vertices.end()), base_vertices.end());
+	std::vector<bool> vertices_queued(base_vertices.size(), false);
+
+	// Vertices and the least detailed LOD
+	int max_lod_count = 1;
+	for (std::size_t i = 0; i < data.draw_sizes.size(); i++)
+	{
+		int coarsest = lod_count(i) - 1;
+		max_lod_count = std::max(max_lod_count, lod_count(i));
+
+		GLint base_vertex = data.base_vertices.empty() ? 0 : data.base_vertices[i];
+		std::size_t range = std::lower_bound(base_vertices.begin(), base_vertices.end(), base_vertex) - base_vertices.begin();
+		if (!vertices_queued[range])
+		{
+			GLint end_vertex = range + 1 < base_vertices.size() ? base_vertices[range + 1] : m_vertex_count;
+			for (std::size_t stream = 0; stream < packed.vertex_streams.size(); stream++)
+				if (!packed.vertex_streams[stream].empty())
+					state->units.push_back({static_cast<int>(stream), base_vertex * strides[stream], (end_vertex - base_vertex) * strides[stream], static_cast<int>(i), coarsest, false});
+			vertices_queued[range] = true;
+		}
+
+		state->units.push_back(index_unit(i, coarsest));
+	}
+
+	// Remaining LODs - from the least detailed ones
+	for (int lod = max_lod_count - 2; lod >= 0; lod--)
+		for (std::size_t i = 0; i < data.draw_sizes.size(); i++)
+			if (lod < lod_count(i) - 1)
+				state->units.push_back(index_unit(i, lod));
+
+	// Nothing to stream - the mesh is resident right away
+	if (state->units.empty())
+		return;
+
+	state->vertex_streams = std::move(packed.vertex_streams);
+	state->indices = std::move(packed.indices);
+	m_streaming = std::move(state);
+}
+
+/**
+	Writes data to one of the vertex streams or to the index buffer.
+	The offset is relative to the mesh's data.
+*/
+void mesh_buffers::write_data(int stream, GLintptr offset, GLsizeiptr size, const void *data)
+{
+	if (!m_arena_allocation)
+	{
+		auto &buffer = stream < 0 ? m_index_buffer : m_vertex_buffers.at(stream);
+		buffer->write(offset, size, data);
+		return;
+	}
+
+	auto &arena = m_arena_allocation->get_arena();
+	if (stream < 0)
+	{
+		arena.write_indices(m_arena_allocation->get_index_offset() + offset, size, data);
+	}
+	else
+	{
+		GLsizei stride = abd::get_vertex_layout_strides(m_vertex_layout).at(stream);
+		arena.get_vertex_buffer(stream).write(m_arena_allocation->get_base_vertex() * stride + offset, size, data);
+	}
+}
+
+/**
+	Uploads up to budget bytes of the data in the priority order.
+	Returns number of bytes uploaded.
+*/
+GLsizeiptr mesh_buffers::stream(GLsizeiptr budget)
+{
+	GLsizeiptr uploaded = 0;
+	while (m_streaming && uploaded < budget)
+	{
+		auto &state = *m_streaming;
+		const auto &unit = state.units[state.next_unit];
+		GLsizeiptr size = std::min(unit.size - state.unit_progress, budget - uploaded);
+
+		const auto &source = unit.stream < 0 ? state.indices : state.vertex_streams[unit.stream];
+		write_data(unit.stream, unit.offset + state.unit_progress, size, source.data() + unit.offset + state.unit_progress);
+		state.unit_progress += size;
+		uploaded += size;
+
+		if (state.unit_progress < unit.size) break;
+
+		// Unit complete
+		if (unit.completes_lod)
+			m_resident_lods[unit.sub_mesh] = unit.lod;
+
+		state.unit_progress = 0;
+		if (++state.next_unit == state.units.size())
+			m_streaming.reset();
+	}
+
+	return uploaded;
+}
+
+/**
+	Stores draw parameters of all sub-meshes, offset by the location
+	of the data in the buffers
+*/
+void mesh_buffers::init_draws(const std::vector<std::vector<sub_mesh_draw>> &draws, GLint base_vertex, GLintptr index_offset)
+{
+	m_draws = draws;
+	for (auto &lod : m_draws)
+		for (auto &draw : lod)
+		{
+			draw.index_offset += index_offset;
+			draw.base_vertex += base_vertex;
+		}
+}
+
+/**
+	Reads contents of a vertex buffer (stream) from the GPU
+*/
+std::vector<std::byte> mesh_buffers::read_vertex_stream(int stream) const
+{
+	GLsizei stride = abd::get_vertex_layout_strides(m_vertex_layout).at(stream);
+	std::vector<std::byte> data(m_vertex_count * stride);
+
+	if (m_arena_allocation)
+		m_arena_allocation->get_arena().read_vertices(stream, m_arena_allocation->get_base_vertex(), m_vertex_count, data.data());
+	else if (m_vertex_buffers.at(stream))
+		m_vertex_buffers[stream]->read(0, data.size(), data.data());
+	else
+		data.clear();
+
+	return data;
+}
+
+/**
+	Reads vertex and index data back from the GPU. The sub-mesh table
+	(materials, number of LODs, meshlets) is taken from the provided
+	mesh data, so the result is equivalent to the data the buffers were
+	created from (within precision of the vertex layout).
+*/
+mesh_data mesh_buffers::read_back(const mesh_data &table) const
+{
+	mesh_data data;
+	data.materials = table.materials;
+	data.meshlets = table.meshlets;
+	data.lods.resize(table.lods.size());
+
+	// Vertices
+	auto unpack_interleaved = [this, &data](auto format)
+	{
+		using format_type = decltype(format);
+		auto stream = read_vertex_stream(0);
+		auto vertices = reinterpret_cast<const typename format_type::vertex*>(stream.data());
+
+		data.positions.resize(m_vertex_count);
+		data.normals.resize(m_vertex_count);
+		data.uvs.resize(m_vertex_count);
+		for (GLsizeiptr i = 0; i < m_vertex_count; i++)
+			format_type::unpack(vertices[i], m_quantization, data.positions[i], data.normals[i], data.uvs[i]);
+	};
+
+	auto copy_stream = [this](int stream, auto &v)
+	{
+		auto bytes = read_vertex_stream(stream);
+		v.resize(bytes.size() / sizeof(v[0]));
+		std::memcpy(v.data(), bytes.data(), bytes.size());
+	};
+
+	switch (m_vertex_layout)
+	{
+		case vertex_layout::INTERLEAVED:
+			unpack_interleaved(abd::interleaved_vertex_format{});
+			break;
+
+		case vertex_layout::COMPACT:
+			unpack_interleaved(abd::compact_vertex_format{});
+			break;
+
+		default:
+			copy_stream(0, data.positions);
+			copy_stream(1, data.normals);
+			copy_stream(2, data.uvs);
+			break;
+	}
+
+	if (!m_has_uvs) data.uvs.clear();
+
+	// Indices - always expanded to GLuint
+	GLint first_vertex = m_arena_allocation ? m_arena_allocation->get_base_vertex() : 0;
+	auto read_indices = [this, &data](const sub_mesh_draw &draw)
+	{
+		std::size_t index_size = draw.index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+		std::vector<std::byte> bytes(draw.count * index_size);
+		if (m_arena_allocation)
+			m_arena_allocation->get_arena().read_indices(draw.index_offset, bytes.size(), bytes.data());
+		else
+			m_index_buffer->read(draw.index_offset, bytes.size(), bytes.data());
+
+		GLint base_index = data.indices.size();
+		for (GLsizei i = 0; i < draw.count; i++)
+		{
+			if (index_size == sizeof(GLushort))
+			{
+				GLushort index;
+				std::memcpy(&index, bytes.data() + i * index_size, sizeof(index));
+				data.indices.push_back(index);
+			}
+			else
+			{
+				GLuint index;
+				std::memcpy(&index, bytes.data() + i * index_size, sizeof(index));
+				data.indices.push_back(index);
+			}
+		}
+
+		return base_index;
+	};
+
+	for (std::size_t i = 0; i < m_draws[0].size(); i++)
+	{
+		const auto &draw = m_draws[0][i];
+		data.base_indices.push_back(read_indices(draw));
+		data.base_vertices.push_back(draw.base_vertex - first_vertex);
+		data.draw_sizes.push_back(draw.count);
+
+		// Only LODs actually present in the sub-mesh
+		if (i < table.lods.size())
+			for (std::size_t lod = 0; lod < table.lods[i].size(); lod++)
+			{
+				const auto &lod_draw = m_draws.at(lod + 1)[i];
+				data.lods[i].push_back({read_indices(lod_draw), lod_draw.count, table.lods[i][lod].error});
+			}
+	}
+
+	return data;
+}
+
+/**
+	Returns VAO layout matching layout of the buffers
+*/
+const abd::vao_layout &mesh_buffers::get_vao_layout() const
+{
+	return abd::get_vao_layout(m_vertex_layout);
 }
 
 /**
 	Binds a set of buffers to a VAO with fixed layout.
 
 	For simplcity it is assumed that buffers have predefined layouts.
-	Fancy stuff such as interleaving will be supported later.
+	The VAO's layout has to match the one returned by get_vao_layout().
 */
 void mesh_buffers::bind_to_vao(abd::fixed_vao &vao) const
 {
-	auto layout = vao.get_layout();
-
-	if (layout.attrib_positions.has_value() && this->m_position_buffer)
-		vao.bind_buffer(layout.attrib_positions->bindingindex, *m_position_buffer, 0, 3 * sizeof(float));
+	if (m_arena_allocation)
+	{
+		m_arena_allocation->get_arena().bind_to_vao(vao);
+		return;
+	}
 
-	if (layout.attrib_normals.has_value() && this->m_normal_buffer)
-		vao.bind_buffer(layout.attrib_normals->bindingindex, *m_normal_buffer, 0, 3 * sizeof(float));
-
-	if (layout.attrib_uvs.has_value() && this->m_uv_buffer)
-		vao.bind_buffer(layout.attrib_uvs->bindingindex, *m_uv_buffer, 0, 2 * sizeof(float));
+	const auto &strides = abd::get_vertex_layout_strides(m_vertex_layout);
+	for (std::size_t i = 0; i < m_vertex_buffers.size(); i++)
+		if (m_vertex_buffers[i])
+			vao.bind_buffer(i, *m_vertex_buffers[i], 0, strides[i]);
 }
 
 /**
@@ -45,5 +611,8 @@ void mesh_buffers::bind_to_vao(abd::fixed_vao &vao) const
 */
 void mesh_buffers::bind_index_buffer() const
 {
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *m_index_buffer);
-}
\ No newline at end of file
+	if (m_arena_allocation)
+		m_arena_allocation->get_arena().bind_index_buffer();
+	else
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *m_index_buffer);
+}
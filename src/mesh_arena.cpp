@@ -0,0 +1,202 @@
+#include <albedo/mesh_arena.hpp>
+#include <albedo/exception.hpp>
+
+using abd::range_allocator;
+using abd::mesh_arena;
+
+range_allocator::range_allocator(GLsizeiptr capacity) :
+	m_capacity(capacity),
+	m_free_size(capacity)
+{
+	if (capacity > 0)
+		m_free_ranges.emplace(0, capacity);
+}
+
+/**
+	Finds the first free range large enough to hold the aligned allocation.
+	Returns nothing if there's no such range.
+*/
+std::optional<GLsizeiptr> range_allocator::allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+	for (auto it = m_free_ranges.begin(); it != m_free_ranges.end(); ++it)
+	{
+		auto [range_offset, range_size] = *it;
+		GLsizeiptr offset = (range_offset + alignment - 1) / alignment * alignment;
+		GLsizeiptr padding = offset - range_offset;
+		if (padding + size > range_size) continue;
+
+		// Split the range - padding in front and the remainder remain free
+		m_free_ranges.erase(it);
+		if (padding > 0)
+			m_free_ranges.emplace(range_offset, padding);
+		if (range_size - padding - size > 0)
+			m_free_ranges.emplace(offset + size, range_size - padding - size);
+
+		m_free_size -= size;
+		return offset;
+	}
+
+	return {};
+}
+
+/**
+	Returns a range to the allocator, merging it with adjacent free ranges
+*/
+void range_allocator::free(GLsizeiptr offset, GLsizeiptr size)
+{
+	if (size <= 0) return;
+	m_free_size += size;
+
+	// Merge with the following range
+	auto next = m_free_ranges.find(offset + size);
+	if (next != m_free_ranges.end())
+	{
+		size += next->second;
+		m_free_ranges.erase(next);
+	}
+
+	// Merge with the preceding range
+	auto it = m_free_ranges.lower_bound(offset);
+	if (it != m_free_ranges.begin())
+	{
+		auto prev = std::prev(it);
+		if (prev->first + prev->second == offset)
+		{
+			prev->second += size;
+			return;
+		}
+	}
+
+	m_free_ranges.emplace(offset, size);
+}
+
+
+
+/**
+	Creates vertex buffers for vertex_capacity vertices in the specified
+	layout and an index buffer of index_buffer_size bytes.
+*/
+mesh_arena::mesh_arena(GLsizeiptr vertex_capacity, GLsizeiptr index_buffer_size, vertex_layout layout) :
+	m_vertex_layout(layout),
+	m_vertex_allocator(vertex_capacity),
+	m_index_allocator(index_buffer_size),
+	m_index_buffer(index_buffer_size, nullptr, GL_DYNAMIC_STORAGE_BIT)
+{
+	for (auto stride : abd::get_vertex_layout_strides(layout))
+		m_vertex_buffers.emplace_back(vertex_capacity * stride, nullptr, GL_DYNAMIC_STORAGE_BIT);
+}
+
+/**
+	Allocates space for vertex_count vertices and index_size bytes of indices.
+	Index ranges are aligned to 4 bytes, so any index type can be used.
+*/
+mesh_arena::allocation mesh_arena::allocate(GLsizeiptr vertex_count, GLsizeiptr index_size)
+{
+	auto vertex_offset = m_vertex_allocator.allocate(vertex_count);
+	if (!vertex_offset)
+		throw abd::exception("mesh_arena is out of vertex space");
+
+	auto index_offset = m_index_allocator.allocate(index_size, sizeof(GLuint));
+	if (!index_offset)
+	{
+		m_vertex_allocator.free(*vertex_offset, vertex_count);
+		throw abd::exception("mesh_arena is out of index space");
+	}
+
+	return allocation(shared_from_this(), *vertex_offset, vertex_count, *index_offset, index_size);
+}
+
+/**
+	Writes data of vertex_count vertices to one of the vertex buffers (see get_vertex_layout_strides())
+*/
+void mesh_arena::write_vertices(int stream, GLsizeiptr first_vertex, GLsizeiptr vertex_count, const void *data)
+{
+	GLsizei stride = abd::get_vertex_layout_strides(m_vertex_layout).at(stream);
+	m_vertex_buffers.at(stream).write(first_vertex * stride, vertex_count * stride, data);
+}
+
+void mesh_arena::write_indices(GLintptr offset, GLsizeiptr size, const void *data)
+{
+	m_index_buffer.write(offset, size, data);
+}
+
+/**
+	Reads vertex data back from the GPU (see write_vertices())
+*/
+void mesh_arena::read_vertices(int stream, GLsizeiptr first_vertex, GLsizeiptr vertex_count, void *data) const
+{
+	GLsizei stride = abd::get_vertex_layout_strides(m_vertex_layout).at(stream);
+	m_vertex_buffers.at(stream).read(first_vertex * stride, vertex_count * stride, data);
+}
+
+void mesh_arena::read_indices(GLintptr offset, GLsizeiptr size, void *data) const
+{
+	m_index_buffer.read(offset, size, data);
+}
+
+/**
+	Binds all vertex buffers to the VAO. Buffer i is bound at binding i.
+*/
+void mesh_arena::bind_to_vao(fixed_vao &vao) const
+{
+	const auto &strides = abd::get_vertex_layout_strides(m_vertex_layout);
+	for (std::size_t i = 0; i < m_vertex_buffers.size(); i++)
+		vao.bind_buffer(i, m_vertex_buffers[i], 0, strides[i]);
+}
+
+void mesh_arena::bind_index_buffer() const
+{
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
+}
+
+void mesh_arena::free(const allocation &alloc)
+{
+	m_vertex_allocator.free(alloc.m_vertex_offset, alloc.m_vertex_count);
+	m_index_allocator.free(alloc.m_index_offset, alloc.m_index_size);
+}
+
+
+
+mesh_arena::allocation::allocation(std::shared_ptr<mesh_arena> arena, GLsizeiptr vertex_offset, GLsizeiptr vertex_count, GLintptr index_offset, GLsizeiptr index_size) :
+	m_arena(std::move(arena)),
+	m_vertex_offset(vertex_offset),
+	m_vertex_count(vertex_count),
+	m_index_offset(index_offset),
+	m_index_size(index_size)
+{
+}
+
+/**
+	Move constructor - invalidates source
+*/
+mesh_arena::allocation::allocation(allocation &&rhs) noexcept :
+	m_arena(std::move(rhs.m_arena)),
+	m_vertex_offset(rhs.m_vertex_offset),
+	m_vertex_count(rhs.m_vertex_count),
+	m_index_offset(rhs.m_index_offset),
+	m_index_size(rhs.m_index_size)
+{
+	rhs.m_arena.reset();
+}
+
+/**
+	Move assignment operator - releases own range and invalidates source
+*/
+mesh_arena::allocation &mesh_arena::allocation::operator=(allocation &&rhs) noexcept
+{
+	if (this == &rhs) return *this;
+	if (m_arena) m_arena->free(*this);
+
+	m_arena = std::move(rhs.m_arena);
+	m_vertex_offset = rhs.m_vertex_offset;
+	m_vertex_count = rhs.m_vertex_count;
+	m_index_offset = rhs.m_index_offset;
+	m_index_size = rhs.m_index_size;
+	rhs.m_arena.reset();
+	return *this;
+}
+
+mesh_arena::allocation::~allocation()
+{
+	if (m_arena) m_arena->free(*this);
+}
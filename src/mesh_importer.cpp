@@ -0,0 +1,146 @@
+#include <albedo/mesh_importer.hpp>
+#include <albedo/simple_loaders.hpp>
+#include <albedo/exception.hpp>
+#include <assimp/Importer.hpp>
+#include <algorithm>
+
+using abd::mesh_importer;
+
+mesh_importer::mesh_importer(unsigned int thread_count)
+{
+	// hardware_concurrency() may return 0
+	thread_count = std::max(thread_count, 1u);
+	for (unsigned int i = 0; i < thread_count; i++)
+		m_workers.emplace_back(&mesh_importer::worker_main, this);
+}
+
+/**
+	Waits for the jobs in progress and cancels all other imports
+*/
+mesh_importer::~mesh_importer()
+{
+	{
+		std::lock_guard lock{m_mutex};
+		m_stop = true;
+	}
+
+	m_cv.notify_all();
+	for (auto &worker : m_workers)
+		worker.join();
+
+	for (auto &job : m_jobs)
+		job.cancel();
+
+	for (auto &completion : m_completions)
+		completion.cancel();
+}
+
+/**
+	Schedules import of a mesh. The mesh is created once it's
+	imported and poll() is called.
+*/
+std::future<std::shared_ptr<abd::mesh>> mesh_importer::import(const boost::filesystem::path &path, const mesh_import_options &options)
+{
+	struct import_job
+	{
+		abd::mesh_data data;
+		abd::packed_mesh packed;
+		std::promise<std::shared_ptr<abd::mesh>> promise;
+	};
+
+	auto job = std::make_shared<import_job>();
+	auto future = job->promise.get_future();
+
+	auto cancel = [job]()
+	{
+		job->promise.set_exception(std::make_exception_ptr(abd::exception("mesh_importer destroyed before the import finished")));
+	};
+
+	std::lock_guard lock{m_mutex};
+	m_pending_count++;
+	m_jobs.push_back({[this, job, path, options, cancel](Assimp::Importer &importer)
+	{
+		try
+		{
+			job->data = abd::assimp_simple_load_mesh(importer, path, options.optimizer, options.lods, options.meshlets);
+			job->packed = abd::pack_mesh(job->data, options.layout);
+		}
+		catch (...)
+		{
+			job->promise.set_exception(std::current_exception());
+			std::lock_guard lock{m_mutex};
+			m_pending_count--;
+			return;
+		}
+
+		std::lock_guard lock{m_mutex};
+		m_completions.push_back({[job]()
+		{
+			try
+			{
+				auto buffers = std::make_unique<abd::mesh_buffers>(job->packed, job->data.meshlets);
+				job->promise.set_value(std::make_shared<abd::mesh>(std::move(job->data), std::move(buffers)));
+			}
+			catch (...)
+			{
+				job->promise.set_exception(std::current_exception());
+			}
+		}, cancel});
+	}, cancel});
+	m_cv.notify_one();
+
+	return future;
+}
+
+/**
+	Schedules import of all meshes. The workers pick them up in the given order.
+*/
+std::vector<std::future<std::shared_ptr<abd::mesh>>> mesh_importer::import(const std::vector<boost::filesystem::path> &paths, const mesh_import_options &options)
+{
+	std::vector<std::future<std::shared_ptr<abd::mesh>>> futures;
+	for (const auto &path : paths)
+		futures.push_back(import(path, options));
+	return futures;
+}
+
+/**
+	Creates GPU buffers of all finished imports and hands the meshes out.
+	Must be called by the thread owning the GL context, e.g. once per frame.
+*/
+void mesh_importer::poll()
+{
+	std::vector<task<>> ready;
+
+	{
+		std::lock_guard lock{m_mutex};
+		ready.swap(m_completions);
+		m_pending_count -= ready.size();
+	}
+
+	for (auto &completion : ready)
+		completion.run();
+}
+
+/**
+	Worker thread - executes import jobs with its own importer
+*/
+void mesh_importer::worker_main()
+{
+	Assimp::Importer importer;
+
+	while (true)
+	{
+		task<Assimp::Importer &> job;
+
+		{
+			std::unique_lock lock{m_mutex};
+			m_cv.wait(lock, [this]{return m_stop || !m_jobs.empty();});
+			if (m_stop) break;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		job.run(importer);
+	}
+}
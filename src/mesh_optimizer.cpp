@@ -0,0 +1,347 @@
+#include <albedo/mesh_optimizer.hpp>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <deque>
+#include <map>
+
+float abd::compute_acmr(const GLuint *indices, std::size_t index_count, int cache_size)
+{
+	if (index_count < 3) return 0.f;
+
+	std::deque<GLuint> cache;
+	std::size_t misses = 0;
+	for (std::size_t i = 0; i < index_count; i++)
+	{
+		if (std::find(cache.begin(), cache.end(), indices[i]) != cache.end()) continue;
+
+		misses++;
+		cache.push_back(indices[i]);
+		if (static_cast<int>(cache.size()) > cache_size)
+			cache.pop_front();
+	}
+
+	return static_cast<float>(misses) / (index_count / 3);
+}
+
+/**
+	Forsyth's vertex score - prefers recently used vertices and
+	vertices with few remaining triangles
+*/
+static float forsyth_vertex_score(int cache_position, int live_triangles)
+{
+	constexpr int cache_size = 32;
+	constexpr float cache_decay_power = 1.5f;
+	constexpr float last_triangle_score = 0.75f;
+	constexpr float valence_boost_scale = 2.f;
+	constexpr float valence_boost_power = 0.5f;
+
+	// No triangles need this vertex anymore
+	if (live_triangles == 0) return -1.f;
+
+	float score = 0.f;
+	if (cache_position >= 0)
+	{
+		// Vertices used by the last triangle get fixed score, so that
+		// the next triangle doesn't re-use all of them
+		if (cache_position < 3)
+			score = last_triangle_score;
+		else
+		{
+			float scaler = 1.f / (cache_size - 3);
+			score = std::pow(1.f - (cache_position - 3) * scaler, cache_decay_power);
+		}
+	}
+
+	return score + valence_boost_scale * std::pow(static_cast<float>(live_triangles), -valence_boost_power);
+}
+
+std::vector<GLuint> abd::optimize_vertex_cache(const GLuint *indices, std::size_t index_count, std::size_t vertex_count)
+{
+	constexpr int cache_size = 32;
+	const std::size_t triangle_count = index_count / 3;
+
+	// Vertex to triangle adjacency - live triangles of vertex v are
+	// adjacency[adjacency_offset[v] .. adjacency_offset[v] + live_triangles[v]]
+	std::vector<int> live_triangles(vertex_count, 0);
+	for (std::size_t i = 0; i < triangle_count * 3; i++)
+		live_triangles[indices[i]]++;
+
+	std::vector<std::size_t> adjacency_offset(vertex_count + 1, 0);
+	std::partial_sum(live_triangles.begin(), live_triangles.end(), adjacency_offset.begin() + 1);
+
+	std::vector<std::size_t> adjacency(triangle_count * 3);
+	{
+		std::vector<std::size_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+		for (std::size_t i = 0; i < triangle_count * 3; i++)
+			adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	std::vector<int> cache_position(vertex_count, -1);
+	std::vector<float> vertex_score(vertex_count);
+	for (std::size_t v = 0; v < vertex_count; v++)
+		vertex_score[v] = forsyth_vertex_score(-1, live_triangles[v]);
+
+	std::vector<float> triangle_score(triangle_count, 0.f);
+	for (std::size_t t = 0; t < triangle_count; t++)
+		for (int j = 0; j < 3; j++)
+			triangle_score[t] += vertex_score[indices[t * 3 + j]];
+
+	std::vector<bool> emitted(triangle_count, false);
+	std::vector<GLuint> cache, new_cache;
+	std::vector<GLuint> result;
+	result.reserve(triangle_count * 3);
+
+	std::size_t cursor = 0;
+	std::ptrdiff_t best = -1;
+	for (std::size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++)
+	{
+		// Dead end - take the next triangle in the original order
+		if (best < 0)
+		{
+			while (emitted[cursor]) cursor++;
+			best = cursor;
+		}
+
+		// Emit the triangle and remove it from adjacency lists
+		emitted[best] = true;
+		for (int j = 0; j < 3; j++)
+		{
+			GLuint v = indices[best * 3 + j];
+			result.push_back(v);
+
+			auto begin = adjacency.begin() + adjacency_offset[v];
+			auto end = begin + live_triangles[v];
+			std::iter_swap(std::find(begin, end, static_cast<std::size_t>(best)), end - 1);
+			live_triangles[v]--;
+		}
+
+		// Vertices of the emitted triangle go to the front of the LRU cache
+		new_cache.assign(result.end() - 3, result.end());
+		for (auto v : cache)
+			if (std::find(new_cache.begin(), new_cache.end(), v) == new_cache.end())
+				new_cache.push_back(v);
+
+		// Update scores of all vertices in the cache and of the evicted ones
+		for (std::size_t i = 0; i < new_cache.size(); i++)
+		{
+			GLuint v = new_cache[i];
+			cache_position[v] = i < cache_size ? static_cast<int>(i) : -1;
+			float score = forsyth_vertex_score(cache_position[v], live_triangles[v]);
+			float delta = score - vertex_score[v];
+			vertex_score[v] = score;
+
+			for (int k = 0; k < live_triangles[v]; k++)
+				triangle_score[adjacency[adjacency_offset[v] + k]] += delta;
+		}
+
+		if (new_cache.size() > cache_size) new_cache.resize(cache_size);
+		std::swap(cache, new_cache);
+
+		// Find the best triangle using cached vertices
+		best = -1;
+		float best_score = -1.f;
+		for (auto v : cache)
+		{
+			for (int k = 0; k < live_triangles[v]; k++)
+			{
+				auto t = adjacency[adjacency_offset[v] + k];
+				if (triangle_score[t] > best_score)
+				{
+					best_score = triangle_score[t];
+					best = t;
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+std::vector<GLuint> abd::optimize_overdraw(const GLuint *indices, std::size_t index_count, const glm::vec3 *positions, int cache_size, float threshold)
+{
+	const std::size_t triangle_count = index_count / 3;
+	std::vector<GLuint> original(indices, indices + triangle_count * 3);
+	if (triangle_count < 2) return original;
+
+	// Split into clusters where all vertices of a triangle miss the cache
+	std::vector<std::size_t> cluster_begin;
+	std::deque<GLuint> cache;
+	for (std::size_t t = 0; t < triangle_count; t++)
+	{
+		int misses = 0;
+		for (int j = 0; j < 3; j++)
+		{
+			GLuint v = indices[t * 3 + j];
+			if (std::find(cache.begin(), cache.end(), v) != cache.end()) continue;
+
+			misses++;
+			cache.push_back(v);
+			if (static_cast<int>(cache.size()) > cache_size)
+				cache.pop_front();
+		}
+
+		if (misses == 3 || t == 0)
+			cluster_begin.push_back(t);
+	}
+	cluster_begin.push_back(triangle_count);
+
+	// Area-weighted centroid and normal of every cluster
+	struct cluster
+	{
+		std::size_t begin, end;
+		glm::vec3 centroid{0.f};
+		glm::vec3 normal{0.f};
+		float sort_key;
+	};
+
+	std::vector<cluster> clusters;
+	glm::vec3 mesh_centroid{0.f};
+	float mesh_area = 0.f;
+	for (std::size_t i = 0; i + 1 < cluster_begin.size(); i++)
+	{
+		cluster c{cluster_begin[i], cluster_begin[i + 1]};
+		float area = 0.f;
+		for (std::size_t t = c.begin; t < c.end; t++)
+		{
+			const auto &a = positions[indices[t * 3 + 0]];
+			const auto &b = positions[indices[t * 3 + 1]];
+			const auto &d = positions[indices[t * 3 + 2]];
+			glm::vec3 n = glm::cross(b - a, d - a);
+			float tri_area = glm::length(n);
+			c.normal += n;
+			c.centroid += (a + b + d) / 3.f * tri_area;
+			area += tri_area;
+		}
+
+		if (area > 0.f) c.centroid /= area;
+		mesh_centroid += c.centroid * area;
+		mesh_area += area;
+		clusters.push_back(c);
+	}
+
+	if (mesh_area > 0.f) mesh_centroid /= mesh_area;
+
+	// Clusters facing outwards are likely to occlude other ones - draw them first
+	for (auto &c : clusters)
+	{
+		float length = glm::length(c.normal);
+		c.sort_key = length > 0.f ? glm::dot(c.centroid - mesh_centroid, c.normal / length) : 0.f;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const cluster &lhs, const cluster &rhs)
+	{
+		return lhs.sort_key > rhs.sort_key;
+	});
+
+	std::vector<GLuint> result;
+	result.reserve(triangle_count * 3);
+	for (const auto &c : clusters)
+		result.insert(result.end(), indices + c.begin * 3, indices + c.end * 3);
+
+	// Reject if vertex cache efficiency suffers too much
+	float acmr_before = abd::compute_acmr(original.data(), original.size(), cache_size);
+	float acmr_after = abd::compute_acmr(result.data(), result.size(), cache_size);
+	if (acmr_after > acmr_before * threshold)
+		return original;
+
+	return result;
+}
+
+/**
+	Reorders vertices in range [first_vertex; first_vertex + vertex_count)
+	in order of first use by the provided index ranges. Unused vertices are
+	moved to the end of the range. Indices are relative to first_vertex.
+*/
+static void optimize_vertex_fetch(abd::mesh_data &data, std::size_t first_vertex, std::size_t vertex_count, const std::vector<std::pair<std::size_t, std::size_t>> &index_ranges)
+{
+	constexpr GLuint unused = ~0u;
+	std::vector<GLuint> remap(vertex_count, unused);
+	GLuint next = 0;
+
+	for (auto [begin, count] : index_ranges)
+		for (std::size_t i = begin; i < begin + count; i++)
+		{
+			auto &index = data.indices[i];
+			if (remap[index] == unused) remap[index] = next++;
+			index = remap[index];
+		}
+
+	for (auto &r : remap)
+		if (r == unused) r = next++;
+
+	auto reorder = [&](auto &v)
+	{
+		if (v.size() < first_vertex + vertex_count) return;
+		auto copy = std::vector<typename std::decay_t<decltype(v)>::value_type>(v.begin() + first_vertex, v.begin() + first_vertex + vertex_count);
+		for (std::size_t i = 0; i < vertex_count; i++)
+			v[first_vertex + remap[i]] = copy[i];
+	};
+
+	reorder(data.positions);
+	reorder(data.normals);
+	reorder(data.uvs);
+}
+
+std::vector<abd::sub_mesh_optimization_report> abd::optimize_mesh(mesh_data &data, const mesh_optimizer_options &options)
+{
+	std::vector<sub_mesh_optimization_report> report;
+	auto get_base_vertex = [&data](std::size_t i) -> std::size_t
+	{
+		return data.base_vertices.empty() ? 0 : data.base_vertices[i];
+	};
+
+	// Reorders triangles in a range of indices belonging to sub-mesh i
+	auto optimize_triangles = [&](std::size_t i, std::size_t base_index, std::size_t index_count)
+	{
+		GLuint *indices = data.indices.data() + base_index;
+		if (index_count < 3) return;
+
+		std::size_t vertex_count = *std::max_element(indices, indices + index_count) + 1;
+		std::vector<GLuint> result(indices, indices + index_count);
+
+		if (options.optimize_vertex_cache)
+			result = abd::optimize_vertex_cache(result.data(), result.size(), vertex_count);
+
+		if (options.optimize_overdraw)
+			result = abd::optimize_overdraw(result.data(), result.size(), data.positions.data() + get_base_vertex(i), options.cache_size, options.overdraw_threshold);
+
+		std::copy(result.begin(), result.end(), indices);
+	};
+
+	// Triangle reordering (per sub-mesh and its LODs)
+	for (std::size_t i = 0; i < data.draw_sizes.size(); i++)
+	{
+		const GLuint *indices = data.indices.data() + data.base_indices[i];
+		float acmr_before = abd::compute_acmr(indices, data.draw_sizes[i], options.cache_size);
+		optimize_triangles(i, data.base_indices[i], data.draw_sizes[i]);
+		float acmr_after = abd::compute_acmr(indices, data.draw_sizes[i], options.cache_size);
+		report.push_back({acmr_before, acmr_after});
+
+		if (i < data.lods.size())
+			for (const auto &lod : data.lods[i])
+				optimize_triangles(i, lod.base_index, lod.draw_size);
+	}
+
+	// Vertex reordering - sub-meshes sharing a base vertex share vertex data too.
+	// LODs are remapped after the full detail versions, which determine the order.
+	if (options.optimize_vertex_fetch)
+	{
+		std::map<std::size_t, std::vector<std::pair<std::size_t, std::size_t>>> groups;
+		for (std::size_t i = 0; i < data.draw_sizes.size(); i++)
+			groups[get_base_vertex(i)].emplace_back(data.base_indices[i], data.draw_sizes[i]);
+
+		for (std::size_t i = 0; i < data.lods.size(); i++)
+			for (const auto &lod : data.lods[i])
+				groups[get_base_vertex(i)].emplace_back(lod.base_index, lod.draw_size);
+
+		for (auto it = groups.begin(); it != groups.end(); ++it)
+		{
+			auto next = std::next(it);
+			std::size_t end_vertex = next != groups.end() ? next->first : data.positions.size();
+			optimize_vertex_fetch(data, it->first, end_vertex - it->first, it->second);
+		}
+	}
+
+	return report;
+}
@@ -0,0 +1,309 @@
+#include <albedo/mesh_simplifier.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <queue>
+#include <tuple>
+
+namespace {
+
+/**
+	Symmetric 4x4 matrix representing sum of squared distances to planes
+*/
+struct quadric
+{
+	std::array<double, 10> m{};
+
+	void add_plane(const glm::vec3 &n, float d, double weight = 1.0)
+	{
+		double a = n.x, b = n.y, c = n.z;
+		double q[10] = {a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, double(d) * d};
+		for (int i = 0; i < 10; i++)
+			m[i] += q[i] * weight;
+	}
+
+	quadric &operator+=(const quadric &rhs)
+	{
+		for (int i = 0; i < 10; i++)
+			m[i] += rhs.m[i];
+		return *this;
+	}
+
+	double evaluate(const glm::vec3 &p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double e = m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+			+ m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+			+ m[7] * z * z + 2 * m[8] * z
+			+ m[9];
+		return std::max(e, 0.0);
+	}
+};
+
+/**
+	A candidate edge collapse (from -> to). Valid only if versions of
+	both vertices haven't changed since it was created.
+*/
+struct collapse
+{
+	double cost;
+	GLuint from, to;
+	unsigned from_version, to_version;
+
+	bool operator>(const collapse &rhs) const
+	{
+		return cost > rhs.cost;
+	}
+};
+
+//! Weight of the constraint planes preserving mesh boundaries
+constexpr double boundary_weight = 10.0;
+
+}
+
+abd::simplification_result abd::simplify_mesh(const GLuint *indices, std::size_t index_count, const glm::vec3 *positions, std::size_t vertex_count, std::size_t target_index_count)
+{
+	const std::size_t triangle_count = index_count / 3;
+
+	// Weld vertices with identical positions
+	std::vector<GLuint> weld(vertex_count);
+	std::vector<GLuint> representative;
+	{
+		std::map<std::tuple<float, float, float>, GLuint> unique;
+		for (std::size_t i = 0; i < vertex_count; i++)
+		{
+			const auto &p = positions[i];
+			auto [it, inserted] = unique.emplace(std::make_tuple(p.x, p.y, p.z), representative.size());
+			if (inserted) representative.push_back(i);
+			weld[i] = it->second;
+		}
+	}
+
+	const std::size_t welded_count = representative.size();
+	auto position = [&](GLuint w) -> const glm::vec3 &
+	{
+		return positions[representative[w]];
+	};
+
+	// Triangles - welded vertices and original vertices of every corner
+	std::vector<std::array<GLuint, 3>> tris;
+	std::vector<std::array<GLuint, 3>> corners;
+	for (std::size_t t = 0; t < triangle_count; t++)
+	{
+		std::array<GLuint, 3> w = {weld[indices[t * 3]], weld[indices[t * 3 + 1]], weld[indices[t * 3 + 2]]};
+		if (w[0] == w[1] || w[1] == w[2] || w[0] == w[2]) continue;
+		tris.push_back(w);
+		corners.push_back({indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]});
+	}
+
+	// Welded vertices used with more than one original vertex lie on attribute
+	// seams (UVs, normals). They must not move, otherwise the corners on one
+	// side of the seam would pick up attributes of the other side.
+	std::vector<bool> seam(welded_count, false);
+	{
+		std::vector<GLuint> first_original(welded_count, ~0u);
+		for (std::size_t t = 0; t < tris.size(); t++)
+			for (int j = 0; j < 3; j++)
+			{
+				auto &original = first_original[tris[t][j]];
+				if (original == ~0u) original = corners[t][j];
+				else if (original != corners[t][j]) seam[tris[t][j]] = true;
+			}
+	}
+
+	std::vector<bool> alive(tris.size(), true);
+	std::size_t alive_count = tris.size();
+
+	// Vertex quadrics and adjacency
+	std::vector<quadric> quadrics(welded_count);
+	std::vector<std::vector<std::size_t>> vertex_tris(welded_count);
+	std::map<std::pair<GLuint, GLuint>, int> edge_use;
+	for (std::size_t t = 0; t < tris.size(); t++)
+	{
+		const auto &w = tris[t];
+		glm::vec3 n = glm::cross(position(w[1]) - position(w[0]), position(w[2]) - position(w[0]));
+		float length = glm::length(n);
+		if (length > 0.f) n /= length;
+		float d = -glm::dot(n, position(w[0]));
+
+		for (int j = 0; j < 3; j++)
+		{
+			quadrics[w[j]].add_plane(n, d);
+			vertex_tris[w[j]].push_back(t);
+
+			GLuint a = w[j], b = w[(j + 1) % 3];
+			edge_use[{std::min(a, b), std::max(a, b)}]++;
+		}
+	}
+
+	// Boundary edges get planes perpendicular to the adjacent face
+	for (std::size_t t = 0; t < tris.size(); t++)
+	{
+		const auto &w = tris[t];
+		glm::vec3 face_normal = glm::cross(position(w[1]) - position(w[0]), position(w[2]) - position(w[0]));
+		for (int j = 0; j < 3; j++)
+		{
+			GLuint a = w[j], b = w[(j + 1) % 3];
+			if (edge_use[{std::min(a, b), std::max(a, b)}] != 1) continue;
+
+			glm::vec3 n = glm::cross(position(b) - position(a), face_normal);
+			float length = glm::length(n);
+			if (length <= 0.f) continue;
+			n /= length;
+
+			float d = -glm::dot(n, position(a));
+			quadrics[a].add_plane(n, d, boundary_weight);
+			quadrics[b].add_plane(n, d, boundary_weight);
+		}
+	}
+
+	// Candidate collapses
+	std::vector<unsigned> version(welded_count, 0);
+	std::vector<bool> removed(welded_count, false);
+	std::priority_queue<collapse, std::vector<collapse>, std::greater<collapse>> heap;
+	auto push_collapse = [&](GLuint from, GLuint to)
+	{
+		if (seam[from]) return;
+
+		quadric q = quadrics[from];
+		q += quadrics[to];
+		heap.push({q.evaluate(position(to)), from, to, version[from], version[to]});
+	};
+
+	for (const auto &[edge, count] : edge_use)
+	{
+		push_collapse(edge.first, edge.second);
+		push_collapse(edge.second, edge.first);
+	}
+
+	// Checks whether moving vertex 'from' to 'to' flips any of the triangles
+	auto flips_triangles = [&](GLuint from, GLuint to)
+	{
+		for (auto t : vertex_tris[from])
+		{
+			if (!alive[t]) continue;
+			const auto &w = tris[t];
+			if (w[0] == to || w[1] == to || w[2] == to) continue;
+
+			std::array<glm::vec3, 3> p, q;
+			for (int j = 0; j < 3; j++)
+			{
+				p[j] = position(w[j]);
+				q[j] = w[j] == from ? position(to) : p[j];
+			}
+
+			glm::vec3 n_before = glm::cross(p[1] - p[0], p[2] - p[0]);
+			glm::vec3 n_after = glm::cross(q[1] - q[0], q[2] - q[0]);
+			if (glm::dot(n_before, n_after) <= 0.f)
+				return true;
+		}
+
+		return false;
+	};
+
+	double max_cost = 0.0;
+	while (alive_count * 3 > target_index_count && !heap.empty())
+	{
+		auto c = heap.top();
+		heap.pop();
+
+		if (removed[c.from] || removed[c.to]) continue;
+		if (c.from_version != version[c.from] || c.to_version != version[c.to]) continue;
+		if (flips_triangles(c.from, c.to)) continue;
+
+		// Original vertex of 'to' on the same side of a seam as 'from' - taken
+		// from a triangle sharing the edge ('from' itself is never on a seam)
+		GLuint to_original = representative[c.to];
+		for (auto t : vertex_tris[c.from])
+		{
+			if (!alive[t]) continue;
+			auto j = std::find(tris[t].begin(), tris[t].end(), c.to) - tris[t].begin();
+			if (j < 3)
+			{
+				to_original = corners[t][j];
+				break;
+			}
+		}
+
+		// Collapse - triangles sharing the edge disappear, others are moved
+		for (auto t : vertex_tris[c.from])
+		{
+			if (!alive[t]) continue;
+			auto &w = tris[t];
+			if (w[0] == c.to || w[1] == c.to || w[2] == c.to)
+			{
+				alive[t] = false;
+				alive_count--;
+				continue;
+			}
+
+			for (int j = 0; j < 3; j++)
+				if (w[j] == c.from)
+				{
+					w[j] = c.to;
+					corners[t][j] = to_original;
+				}
+
+			vertex_tris[c.to].push_back(t);
+		}
+
+		quadrics[c.to] += quadrics[c.from];
+		removed[c.from] = true;
+		version[c.to]++;
+		max_cost = std::max(max_cost, c.cost);
+
+		// Re-evaluate collapses of all edges adjacent to the remaining vertex
+		for (auto t : vertex_tris[c.to])
+		{
+			if (!alive[t]) continue;
+			for (auto w : tris[t])
+			{
+				if (w == c.to) continue;
+				push_collapse(w, c.to);
+				push_collapse(c.to, w);
+			}
+		}
+	}
+
+	simplification_result result;
+	result.error = std::sqrt(max_cost);
+	result.indices.reserve(alive_count * 3);
+	for (std::size_t t = 0; t < tris.size(); t++)
+		if (alive[t])
+			result.indices.insert(result.indices.end(), corners[t].begin(), corners[t].end());
+
+	return result;
+}
+
+void abd::generate_lods(mesh_data &data, const mesh_lod_options &options)
+{
+	data.lods.assign(data.draw_sizes.size(), {});
+
+	for (std::size_t i = 0; i < data.draw_sizes.size(); i++)
+	{
+		std::size_t base_vertex = data.base_vertices.empty() ? 0 : data.base_vertices[i];
+		std::vector<GLuint> previous(data.indices.begin() + data.base_indices[i], data.indices.begin() + data.base_indices[i] + data.draw_sizes[i]);
+		if (previous.empty()) continue;
+
+		std::size_t vertex_count = *std::max_element(previous.begin(), previous.end()) + 1;
+		float error = 0.f;
+
+		for (int lod = 0; lod < options.max_lod_count; lod++)
+		{
+			std::size_t target = static_cast<std::size_t>(previous.size() / 3 * options.reduction_ratio) * 3;
+			auto result = abd::simplify_mesh(previous.data(), previous.size(), data.positions.data() + base_vertex, vertex_count, target);
+
+			// Stop if the mesh can't be simplified further
+			if (result.indices.empty() || result.indices.size() > previous.size() * options.min_reduction)
+				break;
+
+			// Each LOD is simplified from the previous one, so errors accumulate
+			error += result.error;
+
+			data.lods[i].push_back({static_cast<GLint>(data.indices.size()), static_cast<GLint>(result.indices.size()), error});
+			data.indices.insert(data.indices.end(), result.indices.begin(), result.indices.end());
+			previous = std::move(result.indices);
+		}
+	}
+}
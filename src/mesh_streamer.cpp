@@ -0,0 +1,76 @@
+#include <albedo/mesh_streamer.hpp>
+#include <algorithm>
+
+using abd::mesh_streamer;
+
+mesh_streamer::mesh_streamer(GLsizeiptr frame_budget) :
+	m_frame_budget(frame_budget)
+{
+}
+
+/**
+	Creates a mesh with its own buffers and schedules upload of its data.
+	The buffers are allocated at full size right away.
+*/
+std::shared_ptr<abd::mesh> mesh_streamer::add(mesh_data &&data, float priority, vertex_layout layout)
+{
+	auto buffers = std::make_unique<mesh_buffers>(data, layout, abd::deferred_upload);
+	return enqueue(std::make_shared<abd::mesh>(std::move(data), std::move(buffers)), priority);
+}
+
+/**
+	Creates a mesh in the arena and schedules upload of its data
+*/
+std::shared_ptr<abd::mesh> mesh_streamer::add(mesh_data &&data, std::shared_ptr<mesh_arena> arena, float priority)
+{
+	auto buffers = std::make_unique<mesh_buffers>(data, std::move(arena), abd::deferred_upload);
+	return enqueue(std::make_shared<abd::mesh>(std::move(data), std::move(buffers)), priority);
+}
+
+std::shared_ptr<abd::mesh> mesh_streamer::enqueue(std::shared_ptr<mesh> mesh_ptr, float priority)
+{
+	if (!mesh_ptr->get_buffers().is_resident())
+		m_queue.push_back({mesh_ptr, priority});
+	return mesh_ptr;
+}
+
+void mesh_streamer::set_priority(const std::shared_ptr<mesh> &mesh_ptr, float priority)
+{
+	for (auto &e : m_queue)
+		if (e.mesh_ptr.lock() == mesh_ptr)
+			e.priority = priority;
+}
+
+/**
+	Uploads data within the frame budget. Should be called once per frame.
+	Returns number of bytes uploaded.
+*/
+GLsizeiptr mesh_streamer::update()
+{
+	// Drop meshes that no longer exist or are fully resident
+	m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [](const entry &e)
+	{
+		auto ptr = e.mesh_ptr.lock();
+		return !ptr || ptr->get_buffers().is_resident();
+	}), m_queue.end());
+
+	GLsizeiptr uploaded = 0;
+	while (uploaded < m_frame_budget && !m_queue.empty())
+	{
+		// Least detailed LOD first, then by priority
+		auto it = std::max_element(m_queue.begin(), m_queue.end(), [](const entry &lhs, const entry &rhs)
+		{
+			int lhs_lod = lhs.mesh_ptr.lock()->get_buffers().get_next_stream_lod();
+			int rhs_lod = rhs.mesh_ptr.lock()->get_buffers().get_next_stream_lod();
+			if (lhs_lod != rhs_lod) return lhs_lod < rhs_lod;
+			return lhs.priority > rhs.priority;
+		});
+
+		auto &buffers = it->mesh_ptr.lock()->get_buffers();
+		uploaded += buffers.stream(m_frame_budget - uploaded);
+		if (buffers.is_resident())
+			m_queue.erase(it);
+	}
+
+	return uploaded;
+}
@@ -0,0 +1,98 @@
+#include <albedo/meshlet.hpp>
+#include <albedo/mesh.hpp>
+#include <algorithm>
+#include <cmath>
+
+/**
+	Computes bounding sphere and normal cone of a triangle range
+*/
+static abd::meshlet make_meshlet(const GLuint *indices, GLint base_index, GLint draw_size, const glm::vec3 *positions)
+{
+	abd::meshlet m;
+	m.base_index = base_index;
+	m.draw_size = draw_size;
+
+	const GLuint *begin = indices + base_index;
+	const GLuint *end = begin + draw_size;
+
+	glm::vec3 min = positions[*begin], max = positions[*begin];
+	for (auto it = begin; it != end; ++it)
+	{
+		min = glm::min(min, positions[*it]);
+		max = glm::max(max, positions[*it]);
+	}
+
+	m.center = (min + max) * 0.5f;
+	m.radius = 0.f;
+	for (auto it = begin; it != end; ++it)
+		m.radius = std::max(m.radius, glm::length(positions[*it] - m.center));
+
+	// Unit normals of all triangles
+	std::vector<glm::vec3> normals;
+	glm::vec3 axis{0.f};
+	for (auto it = begin; it + 2 < end; it += 3)
+	{
+		glm::vec3 n = glm::cross(positions[it[1]] - positions[it[0]], positions[it[2]] - positions[it[0]]);
+		float length = glm::length(n);
+		if (length <= 0.f) continue;
+
+		normals.push_back(n / length);
+		axis += normals.back();
+	}
+
+	// The cone is useless if normals point in very different directions
+	float axis_length = glm::length(axis);
+	m.cone_axis = axis_length > 0.f ? axis / axis_length : glm::vec3{0.f, 0.f, 1.f};
+	float min_dot = axis_length > 0.f ? 1.f : -1.f;
+	for (const auto &n : normals)
+		min_dot = std::min(min_dot, glm::dot(n, m.cone_axis));
+
+	m.cone_cutoff = min_dot <= 0.1f ? 1.f : std::sqrt(1.f - min_dot * min_dot);
+	return m;
+}
+
+void abd::build_meshlets(mesh_data &data, const meshlet_options &options)
+{
+	data.meshlets.assign(data.draw_sizes.size(), {});
+
+	for (std::size_t i = 0; i < data.draw_sizes.size(); i++)
+	{
+		if (data.draw_sizes[i] / 3 < options.min_sub_mesh_triangles) continue;
+
+		const GLuint *indices = data.indices.data() + data.base_indices[i];
+		const glm::vec3 *positions = data.positions.data() + (data.base_vertices.empty() ? 0 : data.base_vertices[i]);
+		auto &meshlets = data.meshlets[i];
+
+		std::vector<GLuint> vertices;
+		GLint begin = 0;
+		for (GLint t = 0; t + 2 < data.draw_sizes[i]; t += 3)
+		{
+			int new_vertices = 0;
+			for (int j = 0; j < 3; j++)
+				if (std::find(vertices.begin(), vertices.end(), indices[t + j]) == vertices.end())
+					new_vertices++;
+
+			// Start a new meshlet when limits would be exceeded
+			if (static_cast<int>(vertices.size()) + new_vertices > options.max_vertices
+				|| (t - begin) / 3 + 1 > options.max_triangles)
+			{
+				meshlets.push_back(make_meshlet(indices, begin, t - begin, positions));
+				vertices.clear();
+				begin = t;
+			}
+
+			for (int j = 0; j < 3; j++)
+				if (std::find(vertices.begin(), vertices.end(), indices[t + j]) == vertices.end())
+					vertices.push_back(indices[t + j]);
+		}
+
+		if (begin < data.draw_sizes[i])
+			meshlets.push_back(make_meshlet(indices, begin, data.draw_sizes[i] - begin, positions));
+	}
+}
+
+bool abd::is_meshlet_backfacing(const glm::vec3 &center, float radius, const glm::vec3 &cone_axis, float cone_cutoff, const glm::vec3 &camera_position)
+{
+	glm::vec3 view = center - camera_position;
+	return glm::dot(view, cone_axis) >= cone_cutoff * glm::length(view) + radius;
+}
@@ -0,0 +1,186 @@
+#include <albedo/program_cache.hpp>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using abd::program_binary_cache;
+
+namespace {
+
+struct entry_header
+{
+	char magic[4];
+	std::uint32_t format;
+	std::uint64_t key;
+	std::uint64_t size;
+};
+
+constexpr char entry_magic[4] = {'A', 'B', 'D', 'P'};
+
+std::string get_gl_string(GLenum name)
+{
+	auto str = reinterpret_cast<const char*>(glGetString(name));
+	return str ? str : "";
+}
+
+}
+
+/**
+	Creates the cache directory if necessary. The cache is disabled
+	if the driver doesn't support any program binary formats.
+*/
+program_binary_cache::program_binary_cache(const boost::filesystem::path &dir) :
+	m_dir(dir)
+{
+	GLint format_count = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+	m_enabled = format_count > 0;
+
+	m_driver_id = get_gl_string(GL_VENDOR) + "\n" + get_gl_string(GL_RENDERER) + "\n" + get_gl_string(GL_VERSION);
+
+	if (m_enabled)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::create_directories(m_dir, ec);
+		if (ec)
+		{
+			std::cerr << "program_binary_cache: cannot create " << m_dir << " - cache disabled" << std::endl;
+			m_enabled = false;
+		}
+	}
+}
+
+std::uint64_t program_binary_cache::get_key(const std::vector<shader_source> &sources) const
+{
+	abd::fnv1a_hash hash;
+	hash.add(m_driver_id);
+
+	for (const auto &source : sources)
+	{
+		hash.add(&source.type, sizeof(source.type));
+		hash.add(source.source);
+	}
+
+	return hash.get();
+}
+
+/**
+	Loads the program from the cache or compiles it from source and stores
+	its binary. Compilation and link errors are thrown as shader_exception.
+*/
+abd::gl::program program_binary_cache::get_program(const std::vector<shader_source> &sources)
+{
+	return submit_program(sources).finish();
+}
+
+/**
+	Loads the program from the cache or submits it for compilation.
+	The binary is stored once the compiled program is finished.
+*/
+abd::gl::deferred_program program_binary_cache::submit_program(const std::vector<shader_source> &sources)
+{
+	std::uint64_t key = get_key(sources);
+
+	if (auto binary = load(key))
+	{
+		try
+		{
+			gl::program program(*binary);
+			m_hit_count++;
+			return gl::deferred_program(std::move(program));
+		}
+		catch (const gl::shader_exception &ex)
+		{
+			// Rejected by the driver - recompile and replace the entry
+			boost::system::error_code ec;
+			boost::filesystem::remove(get_entry_path(key), ec);
+		}
+	}
+
+	m_miss_count++;
+	return abd::simple_submit_program(sources, [this, key](const gl::program &program)
+	{
+		store(key, program);
+	});
+}
+
+boost::filesystem::path program_binary_cache::get_entry_path(std::uint64_t key) const
+{
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+	return m_dir / ss.str();
+}
+
+/**
+	Damaged or unreadable entries are treated as cache misses
+*/
+std::optional<abd::gl::program_binary> program_binary_cache::load(std::uint64_t key) const
+{
+	if (!m_enabled) return {};
+
+	try
+	{
+		std::ifstream f(get_entry_path(key).string(), std::ios::binary);
+		if (!f) return {};
+
+		entry_header header;
+		if (!f.read(reinterpret_cast<char*>(&header), sizeof(header))) return {};
+		if (std::memcmp(header.magic, entry_magic, sizeof(entry_magic)) || header.key != key) return {};
+
+		// The binary must take up exactly the rest of the file
+		auto data_begin = f.tellg();
+		if (!f.seekg(0, std::ios::end)) return {};
+		auto data_end = f.tellg();
+		if (data_begin < 0 || data_end < data_begin || static_cast<std::uint64_t>(data_end - data_begin) != header.size) return {};
+		if (!f.seekg(data_begin)) return {};
+
+		gl::program_binary binary{header.format, std::vector<std::byte>(header.size)};
+		if (!f.read(reinterpret_cast<char*>(binary.data.data()), header.size)) return {};
+
+		return binary;
+	}
+	catch (const std::exception &ex)
+	{
+		return {};
+	}
+}
+
+/**
+	Writes the entry to a temporary file first, so an interrupted
+	write never leaves a truncated entry behind.
+*/
+void program_binary_cache::store(std::uint64_t key, const gl::program &program) const
+{
+	if (!m_enabled) return;
+
+	auto binary = program.get_binary();
+	if (binary.data.empty()) return;
+
+	entry_header header;
+	std::memcpy(header.magic, entry_magic, sizeof(entry_magic));
+	header.format = binary.format;
+	header.key = key;
+	header.size = binary.data.size();
+
+	auto path = get_entry_path(key);
+	auto tmp_path = path;
+	tmp_path += ".tmp";
+
+	{
+		std::ofstream f(tmp_path.string(), std::ios::binary);
+		f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		f.write(reinterpret_cast<const char*>(binary.data.data()), binary.data.size());
+		if (!f)
+		{
+			std::cerr << "program_binary_cache: cannot write " << tmp_path << std::endl;
+			return;
+		}
+	}
+
+	boost::system::error_code ec;
+	boost::filesystem::rename(tmp_path, path, ec);
+	if (ec)
+		std::cerr << "program_binary_cache: cannot write " << path << std::endl;
+}
@@ -1,11 +1,16 @@
 #include <albedo/renderer.hpp>
 #include <albedo/exception.hpp>
 #include <albedo/gl/program.hpp>
+#include <albedo/gl/state_cache.hpp>
 #include <albedo/simple_loaders.hpp>
+#include <albedo/program_cache.hpp>
 #include <albedo/gl/debug.hpp>
 #include <iostream>
 #include <array>
+#include <cstddef>
 #include <future>
+#include <algorithm>
+#include <cmath>
 
 using abd::deferred_renderer;
 
@@ -24,24 +29,37 @@ bool abd::light_draw_task::operator<(const abd::light_draw_task &rhs) const
 	else return this->volume < rhs.volume;
 }
 
-deferred_renderer::deferred_renderer(int width, int height) :
+deferred_renderer::deferred_renderer(int width, int height, const boost::filesystem::path &program_cache_dir) :
 	m_blit_quad(6 * 3 * sizeof(float), nullptr, GL_DYNAMIC_STORAGE_BIT),
-	m_lights_buffer(max_light_count * sizeof(ubo_light_data), GL_MAP_WRITE_BIT),
+	m_stream_buffer(stream_buffer_frame_size),
+	m_histogram_buffer(histogram_bin_count * sizeof(GLuint), nullptr, GL_DYNAMIC_STORAGE_BIT),
+	m_exposure_buffer(2 * sizeof(GLfloat), nullptr, GL_DYNAMIC_STORAGE_BIT),
+	m_last_frame_time(std::chrono::steady_clock::now()),
+	m_start_time(m_last_frame_time),
 	m_fbo_width(width),
 	m_fbo_height(height)
 {
-	// Load shaders
+	// Submit all shaders for compilation - they're finished before the first frame
+	gl::set_shader_compiler_threads();
 	try
 	{
-		m_geometry_program = std::make_unique<gl::program>(abd::simple_load_shader_dir("albedo/deferred/geometry_pass"));
-		m_shading_program = std::make_unique<gl::program>(abd::simple_load_shader_dir("albedo/deferred/shading"));
-		m_postprocess_program = std::make_unique<gl::program>(abd::simple_load_shader_dir("albedo/deferred/postprocess"));
-	}
-	catch (const abd::gl::shader_exception &ex)
-	{
-		std::cerr << ex.what() << std::endl;
-		std::cerr << ex.get_compile_log() << std::endl;
-		throw abd::exception("deferred_renderer could not compile essential shaders");
+		if (!program_cache_dir.empty())
+			m_program_cache = std::make_unique<program_binary_cache>(program_cache_dir);
+
+		// Shaders embedded in the library (or ALBEDO_SHADER_DIR) - shared code
+		// (e.g. PBR functions) is included from common/
+		m_shader_cache = std::make_unique<shader_permutation_cache>(shader_preprocessor{{""}, shader_files::albedo_shaders()}, m_program_cache.get());
+
+		m_pending_programs = {
+			{&deferred_renderer::m_geometry_program, "deferred/geometry_pass"},
+			{&deferred_renderer::m_shading_program, "deferred/shading"},
+			{&deferred_renderer::m_postprocess_program, "deferred/postprocess"},
+			{&deferred_renderer::m_histogram_program, "deferred/luminance_histogram"},
+			{&deferred_renderer::m_exposure_program, "deferred/exposure_adapt"},
+		};
+
+		for (const auto &p : m_pending_programs)
+			m_shader_cache->submit(p.dir);
 	}
 	catch (const std::exception &ex)
 	{
@@ -62,6 +80,12 @@ deferred_renderer::deferred_renderer(int width, int height) :
 	};
 	m_blit_quad.write(0, quad_data.size() * sizeof(float), quad_data.data());
 
+	// Empty histogram and initial exposure of 1
+	std::vector<GLuint> histogram_data(histogram_bin_count, 0);
+	m_histogram_buffer.write(0, histogram_data.size() * sizeof(GLuint), histogram_data.data());
+	std::array<GLfloat, 2> exposure_data = {exposure_key, 1.f};
+	m_exposure_buffer.write(0, exposure_data.size() * sizeof(GLfloat), exposure_data.data());
+
 	// Create depth texture
 	m_gbuffer.depth.storage_2d(gl::texture_format::DEPTH_32F, width, height);
 	m_gbuffer.depth.set_min_filter(GL_LINEAR);
@@ -100,16 +124,171 @@ deferred_renderer::deferred_renderer(int width, int height) :
 
 	if (!m_fbo.is_complete())
 		throw abd::exception("deferred_renderer's FBO is incomplete!");
+
+	// G-buffer textures read by the shading pass (standard layout)
+	m_shading_bindings.set_texture(1, m_gbuffer.position);
+	m_shading_bindings.set_texture(2, m_gbuffer.normal);
+	m_shading_bindings.set_texture(3, m_gbuffer.diffuse);
+	m_shading_bindings.set_texture(4, m_gbuffer.specular);
+
+	// Both exposure programs share these bindings
+	m_exposure_bindings.set_texture(0, m_color_buffer);
+	m_exposure_bindings.set_storage_buffer(0, m_histogram_buffer, 0, histogram_bin_count * sizeof(GLuint));
+	m_exposure_bindings.set_storage_buffer(1, m_exposure_buffer, 0, 2 * sizeof(GLfloat));
+
+	m_postprocess_bindings.set_texture(0, m_color_buffer);
+	m_postprocess_bindings.set_storage_buffer(1, m_exposure_buffer, 0, 2 * sizeof(GLfloat));
+}
+
+
+/**
+	Returns true if all programs are compiled and the first frame won't wait for them
+*/
+bool deferred_renderer::is_ready() const
+{
+	return std::all_of(m_pending_programs.begin(), m_pending_programs.end(), [this](const pending_program &p)
+	{
+		return m_shader_cache->is_ready(p.dir);
+	});
+}
+
+/**
+	Waits for all submitted programs to be compiled and linked
+*/
+void deferred_renderer::finish_programs()
+{
+	try
+	{
+		for (auto &p : m_pending_programs)
+			this->*p.target = &m_shader_cache->get(p.dir);
+		m_pending_programs.clear();
+
+		init_uniform_handles();
+		check_buffer_layouts();
+	}
+	catch (const abd::gl::shader_exception &ex)
+	{
+		std::cerr << ex.what() << std::endl;
+		std::cerr << ex.get_compile_log() << std::endl;
+		throw abd::exception("deferred_renderer could not compile essential shaders");
+	}
 }
 
+/**
+	Resolves uniforms of all programs, so they don't have to be looked up every frame
+*/
+void deferred_renderer::init_uniform_handles()
+{
+	auto &geometry = *m_geometry_program;
+	m_geometry_uniforms.mat_model = geometry.get_uniform_handle<glm::mat4>("mat_model");
+	m_geometry_uniforms.position_scale = geometry.get_uniform_handle<glm::vec3>("position_scale");
+	m_geometry_uniforms.position_bias = geometry.get_uniform_handle<glm::vec3>("position_bias");
+	m_geometry_uniforms.material_diffuse = geometry.get_uniform_handle<glm::vec3>("material.diffuse");
+	m_geometry_uniforms.material_specular = geometry.get_uniform_handle<GLfloat>("material.specular");
+	m_geometry_uniforms.material_roughness = geometry.get_uniform_handle<GLfloat>("material.roughness");
+	m_geometry_uniforms.material_specular_tint = geometry.get_uniform_handle<GLfloat>("material.specular_tint");
+
+	auto &shading = *m_shading_program;
+	m_shading_uniforms.base_light_index = shading.get_uniform_handle<GLint>("base_light_index");
+	m_shading_uniforms.light_count = shading.get_uniform_handle<GLint>("light_count");
+
+	auto &histogram = *m_histogram_program;
+	m_histogram_uniforms.min_log_luminance = histogram.get_uniform_handle<GLfloat>("min_log_luminance");
+	m_histogram_uniforms.inv_log_luminance_range = histogram.get_uniform_handle<GLfloat>("inv_log_luminance_range");
+
+	auto &exposure = *m_exposure_program;
+	m_exposure_uniforms.min_log_luminance = exposure.get_uniform_handle<GLfloat>("min_log_luminance");
+	m_exposure_uniforms.log_luminance_range = exposure.get_uniform_handle<GLfloat>("log_luminance_range");
+	m_exposure_uniforms.pixel_count = exposure.get_uniform_handle<GLint>("pixel_count");
+	m_exposure_uniforms.adaptation_rate = exposure.get_uniform_handle<GLfloat>("adaptation_rate");
+	m_exposure_uniforms.exposure_key = exposure.get_uniform_handle<GLfloat>("exposure_key");
+}
+
+/**
+	Checks that the C++ structs match std140 layout of the GLSL blocks
+	(at compile time) and the layout reported by the programs
+*/
+void deferred_renderer::check_buffer_layouts() const
+{
+	static_assert(gl::check_buffer_layout<gl::buffer_layout::STD140, ubo_frame_data,
+		glm::mat4, glm::mat4, glm::mat4, glm::mat4, glm::mat4, glm::mat4, glm::vec2, glm::vec2, glm::vec2, GLfloat, GLfloat>({
+			offsetof(ubo_frame_data, mat_view),
+			offsetof(ubo_frame_data, mat_proj),
+			offsetof(ubo_frame_data, mat_vp),
+			offsetof(ubo_frame_data, mat_inv_view),
+			offsetof(ubo_frame_data, mat_inv_proj),
+			offsetof(ubo_frame_data, mat_inv_vp),
+			offsetof(ubo_frame_data, viewport_size),
+			offsetof(ubo_frame_data, inv_viewport_size),
+			offsetof(ubo_frame_data, jitter),
+			offsetof(ubo_frame_data, time),
+			offsetof(ubo_frame_data, delta_time),
+		}), "ubo_frame_data doesn't match std140 layout");
+
+	static_assert(gl::check_buffer_layout<gl::buffer_layout::STD140, ubo_light_data,
+		GLint, GLfloat, glm::vec4, glm::vec4, glm::vec4>({
+			offsetof(ubo_light_data, light_type),
+			offsetof(ubo_light_data, blend),
+			offsetof(ubo_light_data, color_specular),
+			offsetof(ubo_light_data, position_distance),
+			offsetof(ubo_light_data, direction_angle),
+		}), "ubo_light_data doesn't match std140 layout");
+
+	std::vector<gl::buffer_field> frame_fields = {
+		{"mat_view", offsetof(ubo_frame_data, mat_view)},
+		{"mat_proj", offsetof(ubo_frame_data, mat_proj)},
+		{"mat_vp", offsetof(ubo_frame_data, mat_vp)},
+		{"mat_inv_view", offsetof(ubo_frame_data, mat_inv_view)},
+		{"mat_inv_proj", offsetof(ubo_frame_data, mat_inv_proj)},
+		{"mat_inv_vp", offsetof(ubo_frame_data, mat_inv_vp)},
+		{"viewport_size", offsetof(ubo_frame_data, viewport_size)},
+		{"inv_viewport_size", offsetof(ubo_frame_data, inv_viewport_size)},
+		{"jitter", offsetof(ubo_frame_data, jitter)},
+		{"time", offsetof(ubo_frame_data, time)},
+		{"delta_time", offsetof(ubo_frame_data, delta_time)},
+	};
+
+	for (auto program : {m_geometry_program, m_shading_program})
+		gl::check_uniform_layout(*program, "FRAME_UBO.", frame_fields);
+
+	std::vector<gl::buffer_field> light_fields = {
+		{"type", offsetof(ubo_light_data, light_type)},
+		{"blend", offsetof(ubo_light_data, blend)},
+		{"color_specular", offsetof(ubo_light_data, color_specular)},
+		{"position_distance", offsetof(ubo_light_data, position_distance)},
+		{"direction_angle", offsetof(ubo_light_data, direction_angle)},
+	};
+
+	// The second element checks the array stride
+	gl::check_uniform_layout(*m_shading_program, "LIGHTS_UBO.lights_data[0].", light_fields);
+	gl::check_uniform_layout(*m_shading_program, "LIGHTS_UBO.lights_data[1].", light_fields, sizeof(ubo_light_data));
+}
 
 void deferred_renderer::render(abd::draw_task_list draw_tasks, const abd::camera &camera, GLuint output_fbo)
 {
+	// Programs are used for the first time
+	if (!m_pending_programs.empty())
+		finish_programs();
+
+	// Measure frame time for exposure adaptation
+	auto now = std::chrono::steady_clock::now();
+	float dt = std::chrono::duration<float>(now - m_last_frame_time).count();
+	m_last_frame_time = now;
+
+	// The application may have changed the GL state since the last frame
+	gl::state_cache::get().invalidate();
+
+	// Acquire memory for this frame's transient data
+	m_stream_buffer.begin_frame();
+
+	// Matrices and other constants shared by all passes
+	prepare_frame_data(camera, dt);
+
 	// Prepare lighting data while the geometry is rendered
-	auto lights_buffer_chunk = m_lights_buffer.get_chunk();
-	auto lights_data_ready = std::async([this, &draw_tasks, &lights_buffer_chunk]()
+	auto lights_data = m_stream_buffer.allocate_uniform(max_light_count * sizeof(ubo_light_data));
+	auto lights_data_ready = std::async([this, &draw_tasks, &lights_data]()
 	{
-		this->prepare_lights_data(draw_tasks.light_draw_tasks, lights_buffer_chunk);
+		this->prepare_lights_data(draw_tasks.light_draw_tasks, lights_data);
 	});
 
 	// Start the geometry pass
@@ -117,22 +296,57 @@ void deferred_renderer::render(abd::draw_task_list draw_tasks, const abd::camera
 
 	// Wait for lighting data to be processed and initiate lighting pass
 	lights_data_ready.wait();
-	lighting_pass(draw_tasks.light_draw_tasks, lights_buffer_chunk, camera);
+	m_stream_buffer.flush();
+	lighting_pass(draw_tasks.light_draw_tasks, lights_data);
+
+	// Compute exposure from the HDR image (entirely on the GPU)
+	exposure_pass(dt);
 
 	// Postprocess and output image to the output FBO
 	postprocess_to_output(output_fbo);
+
+	// Flush and fence all transient data
+	m_stream_buffer.end_frame();
+}
+
+/**
+	Writes per-frame constants to the stream buffer and binds them to
+	the frame UBO binding point, where they stay for the whole frame
+*/
+void deferred_renderer::prepare_frame_data(const abd::camera &camera, float dt)
+{
+	auto allocation = m_stream_buffer.allocate_uniform(sizeof(ubo_frame_data));
+	auto &data = *allocation.get_ptr<ubo_frame_data>();
+
+	glm::vec2 viewport_size(m_fbo_width, m_fbo_height);
+	glm::mat4 jitter_offset = glm::translate(glm::mat4{1.f}, glm::vec3(2.f * m_jitter / viewport_size, 0.f));
+
+	data.mat_view = camera.get_view_matrix();
+	data.mat_proj = jitter_offset * camera.get_projection_matrix();
+	data.mat_vp = data.mat_proj * data.mat_view;
+	data.mat_inv_view = glm::inverse(data.mat_view);
+	data.mat_inv_proj = glm::inverse(data.mat_proj);
+	data.mat_inv_vp = glm::inverse(data.mat_vp);
+	data.viewport_size = viewport_size;
+	data.inv_viewport_size = 1.f / viewport_size;
+	data.jitter = m_jitter;
+	data.time = std::chrono::duration<float>(m_last_frame_time - m_start_time).count();
+	data.delta_time = dt;
+
+	m_stream_buffer.flush(allocation);
+	glBindBufferRange(GL_UNIFORM_BUFFER, frame_ubo_binding, *allocation.buffer, allocation.offset, allocation.size);
 }
 
 /**
 	Prepares light data in the light's UBO asynchronously while the geometry is being processed.
 */
-void deferred_renderer::prepare_lights_data(std::vector<light_draw_task> &light_tasks, gl::synced_buffer_handle &lights_buffer_chunk)
+void deferred_renderer::prepare_lights_data(std::vector<light_draw_task> &light_tasks, const gl::stream_allocation &lights_allocation)
 {
-	auto *lights_data = static_cast<ubo_light_data*>(lights_buffer_chunk.get_ptr());
+	auto lights_data = lights_allocation.get_array<ubo_light_data>();
 
 	// Sort lights in the processing order
 	std::sort(light_tasks.begin(), light_tasks.end());
-	if (light_tasks.size() > max_light_count)
+	if (light_tasks.size() > lights_data.size())
 		throw abd::exception("too many light draw tasks passed to the renderer");
 
 	for (unsigned int i = 0; i < light_tasks.size(); i++)
@@ -149,12 +363,140 @@ void deferred_renderer::prepare_lights_data(std::vector<light_draw_task> &light_
 }
 
 
+/**
+	Selects the least detailed LOD whose geometric error projected
+	onto the screen doesn't exceed lod_error_threshold pixels.
+*/
+int deferred_renderer::select_lod(const mesh_draw_task &task, const abd::camera &camera) const
+{
+	const auto &buffers = task.mesh_ptr->get_buffers();
+	int lod_count = buffers.get_lod_count();
+	if (lod_count == 1) return 0;
+
+	// Bounding sphere in world space
+	const auto &sphere = buffers.get_bounding_sphere();
+	glm::vec3 center{task.transform * glm::vec4{sphere.center, 1.f}};
+	float scale = std::max({
+		glm::length(glm::vec3{task.transform[0]}),
+		glm::length(glm::vec3{task.transform[1]}),
+		glm::length(glm::vec3{task.transform[2]})});
+	float distance = glm::length(center - camera.get_position()) - sphere.radius * scale;
+
+	// Camera inside the bounding sphere
+	if (distance <= 1e-3f)
+	{
+		if (task.lod_state) task.lod_state->lod = 0;
+		return 0;
+	}
+
+	// Size of the error on screen (in pixels)
+	float pixels_per_unit = m_fbo_height * 0.5f * camera.get_projection_matrix()[1][1] / distance;
+	auto projected_error = [&](int lod)
+	{
+		return buffers.get_lod_error(lod) * scale * pixels_per_unit;
+	};
+
+	// Without state - pick LOD directly
+	if (!task.lod_state)
+	{
+		int lod = 0;
+		while (lod + 1 < lod_count && projected_error(lod + 1) <= lod_error_threshold) lod++;
+		return lod;
+	}
+
+	// With hysteresis - refine only if the error is well above the threshold
+	// and coarsen only if it's well below
+	int lod = std::clamp(task.lod_state->lod, 0, lod_count - 1);
+	while (lod > 0 && projected_error(lod) > lod_error_threshold * (1.f + lod_hysteresis)) lod--;
+	while (lod + 1 < lod_count && projected_error(lod + 1) < lod_error_threshold * (1.f - lod_hysteresis)) lod++;
+	task.lod_state->lod = lod;
+	return lod;
+}
+
+/**
+	Sub-meshes without a material are drawn two-sided
+*/
+static bool is_two_sided(const abd::mesh_data &data, std::size_t sub_mesh)
+{
+	return sub_mesh >= data.materials.size() || !data.materials[sub_mesh] || data.materials[sub_mesh]->get_data().two_sided;
+}
+
+/**
+	Performs frustum culling of the whole mesh and then frustum
+	and normal cone culling of meshlets (only at full detail).
+	Normal cone culling is skipped for two-sided materials.
+	Indirect commands for visible meshlets are appended to the vector.
+*/
+deferred_renderer::mesh_visibility deferred_renderer::cull_mesh(const mesh_draw_task &task, const abd::camera &camera, const abd::frustum &view_frustum, std::vector<gl::draw_elements_indirect_command> &commands) const
+{
+	const auto &buffers = task.mesh_ptr->get_buffers();
+	mesh_visibility result;
+
+	float scale = std::max({
+		glm::length(glm::vec3{task.transform[0]}),
+		glm::length(glm::vec3{task.transform[1]}),
+		glm::length(glm::vec3{task.transform[2]})});
+
+	const auto &sphere = buffers.get_bounding_sphere();
+	glm::vec3 center{task.transform * glm::vec4{sphere.center, 1.f}};
+	result.visible = view_frustum.intersects_sphere(center, sphere.radius * scale);
+	if (!result.visible) return result;
+
+	result.lod = select_lod(task, camera);
+	result.sub_meshes.resize(buffers.get_draws().size());
+
+	// Normals are transformed with the inverse transpose
+	glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3{task.transform}));
+
+	for (unsigned int i = 0; i < result.sub_meshes.size(); i++)
+	{
+		// Use the best LOD available if the desired one isn't resident yet
+		auto &sub_mesh = result.sub_meshes[i];
+		int resident_lod = buffers.get_resident_lod(i);
+		sub_mesh.lod = resident_lod < 0 ? -1 : std::max(result.lod, resident_lod);
+		sub_mesh.first_command = 0;
+		sub_mesh.command_count = -1;
+
+		// Meshlets are only available at full detail
+		const auto &meshlets = buffers.get_meshlets(i);
+		if (sub_mesh.lod != 0 || meshlets.empty()) continue;
+
+		const auto &draw = buffers.get_draws(0)[i];
+		GLuint index_size = draw.index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+		sub_mesh.first_command = commands.size();
+		sub_mesh.command_count = 0;
+		bool two_sided = is_two_sided(task.mesh_ptr->get_data(), i);
+
+		for (const auto &m : meshlets)
+		{
+			glm::vec3 m_center{task.transform * glm::vec4{m.center, 1.f}};
+			float m_radius = m.radius * scale;
+			if (!view_frustum.intersects_sphere(m_center, m_radius)) continue;
+
+			glm::vec3 axis = glm::normalize(normal_matrix * m.cone_axis);
+			if (!two_sided && abd::is_meshlet_backfacing(m_center, m_radius, axis, m.cone_cutoff, camera.get_position())) continue;
+
+			commands.push_back({
+				static_cast<GLuint>(m.draw_size),
+				1,
+				static_cast<GLuint>(draw.index_offset / index_size + m.base_index),
+				draw.base_vertex,
+				0
+			});
+			sub_mesh.command_count++;
+		}
+	}
+
+	return result;
+}
+
 void deferred_renderer::geometry_pass(std::vector<mesh_draw_task> &mesh_tasks, const abd::camera &camera)
 {
 	abd::gl::debug_group d(0, "abd::deferred_renderer geometry pass");
+	auto &state = gl::state_cache::get();
 
 	// Beginning of the geometry pass - bind MRT
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+	state.bind_framebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
 	m_fbo.set_draw_buffers({
 		GL_COLOR_ATTACHMENT0,
 		GL_COLOR_ATTACHMENT1,
@@ -163,110 +505,153 @@ void deferred_renderer::geometry_pass(std::vector<mesh_draw_task> &mesh_tasks, c
 		GL_COLOR_ATTACHMENT4,
 	});
 
-	// Use the main VAO and geometry pass program
-	m_vao.bind();
+	// Use the geometry pass program (the VAO depends on mesh vertex layout)
 	m_geometry_program->use();
 
 	// Clear buffers, enable depth test and disable blending
 	glClearColor(0, 0, 0, 0);
-	glDepthMask(GL_TRUE);
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
-	glDisable(GL_BLEND);
+	state.depth_mask(GL_TRUE);
+	state.enable(GL_DEPTH_TEST);
+	state.depth_func(GL_LESS);
+	state.disable(GL_BLEND);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Get uniform locations (TODO this should only be done once)
-	auto &uni_mat_model = m_geometry_program->get_uniform("mat_model");
-	auto &uni_mat_view = m_geometry_program->get_uniform("mat_view");
-	auto &uni_mat_proj = m_geometry_program->get_uniform("mat_proj");
-	auto &uni_mat_vp = m_geometry_program->get_uniform("mat_vp");
-	auto &uni_mat_mvp = m_geometry_program->get_uniform("mat_mvp");
+	// View and projection matrices are in the frame UBO
+	auto &uniforms = m_geometry_uniforms;
 
-	// Pass view and projection matrices to the shader
-	uni_mat_view = camera.get_view_matrix();
-	uni_mat_proj = camera.get_projection_matrix();
-	uni_mat_vp = camera;
+	// Cull all meshes first, so that all indirect commands can be
+	// written to the stream buffer and flushed at once
+	//! \todo occlusion culling (requires a depth pyramid)
+	auto view_frustum = abd::frustum::from_matrix(camera.get_matrix());
+	std::vector<gl::draw_elements_indirect_command> commands;
+	std::vector<mesh_visibility> visibility;
+	visibility.reserve(mesh_tasks.size());
+	for (const auto &task : mesh_tasks)
+		visibility.push_back(cull_mesh(task, camera, view_frustum, commands));
+
+	gl::stream_allocation commands_data{};
+	if (!commands.empty())
+	{
+		commands_data = m_stream_buffer.allocate_array<gl::draw_elements_indirect_command>(commands.size());
+		std::copy(commands.begin(), commands.end(), commands_data.get_ptr<gl::draw_elements_indirect_command>());
+		m_stream_buffer.flush(commands_data);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, *commands_data.buffer);
+	}
+
+	// Meshes sharing an arena share buffers too - avoid rebinding them
+	const abd::fixed_vao *bound_vao = nullptr;
+	const abd::mesh_arena *bound_arena = nullptr;
 
 	//! \todo sort mesh draw_tasks to minimize context-changes
-	// Execute every draw task
-	for (const auto &task : mesh_tasks)
+	// Execute every visible draw task
+	for (std::size_t task_index = 0; task_index < mesh_tasks.size(); task_index++)
 	{
+		const auto &task = mesh_tasks[task_index];
+		const auto &task_visibility = visibility[task_index];
+		if (!task_visibility.visible) continue;
+
 		auto &mesh = *task.mesh_ptr;
 		auto &mesh_data = mesh.get_data();
 		auto &mesh_buffers = mesh.get_buffers();
 
-		mesh_buffers.bind_index_buffer();
-		mesh_buffers.bind_to_vao(m_vao);
+		// Bind VAO matching mesh's vertex layout (before binding the index buffer)
+		abd::fixed_vao *vao_ptr = &m_vao;
+		if (mesh_buffers.get_vertex_layout() == abd::vertex_layout::INTERLEAVED) vao_ptr = &m_interleaved_vao;
+		else if (mesh_buffers.get_vertex_layout() == abd::vertex_layout::COMPACT) vao_ptr = &m_compact_vao;
+		auto &vao = *vao_ptr;
+		if (&vao != bound_vao || !mesh_buffers.get_arena() || mesh_buffers.get_arena() != bound_arena)
+		{
+			vao.bind();
+			mesh_buffers.bind_index_buffer();
+			mesh_buffers.bind_to_vao(vao);
+			bound_vao = &vao;
+			bound_arena = mesh_buffers.get_arena();
+		}
 
 		// Update model matrix
-		uni_mat_model = task.transform;
-		uni_mat_mvp = camera.get_matrix() * task.transform;
+		uniforms.mat_model = task.transform;
+
+		// Dequantization parameters
+		uniforms.position_scale = mesh_buffers.get_quantization().position_scale;
+		uniforms.position_bias = mesh_buffers.get_quantization().position_bias;
 
-		//! \todo replace with glMutliDraw*()
 		// Draw all sub-meshes one by one
-		for (unsigned int i = 0; i < mesh_data.base_indices.size(); i++)
+		for (unsigned int i = 0; i < task_visibility.sub_meshes.size(); i++)
 		{
+			// Not resident or all meshlets culled
+			const auto &sub_mesh = task_visibility.sub_meshes[i];
+			if (sub_mesh.lod < 0 || sub_mesh.command_count == 0) continue;
+
+			// Back faces are culled unless the material is two-sided
+			if (is_two_sided(mesh_data, i))
+				state.disable(GL_CULL_FACE);
+			else
+				state.enable(GL_CULL_FACE);
+
 			//! \todo replace with preprocessed material data fed into an UBO
 			if (mesh_data.materials[i])
 			{
 				auto material = mesh_data.materials[i]->get_data();
-				m_geometry_program->get_uniform("material.diffuse") = material.diffuse;
-				m_geometry_program->get_uniform("material.specular") = material.specular;
-				m_geometry_program->get_uniform("material.roughness") = material.roughness;
-				m_geometry_program->get_uniform("material.specular_tint") = material.specular_tint;
+				uniforms.material_diffuse = material.diffuse;
+				uniforms.material_specular = material.specular;
+				uniforms.material_roughness = material.roughness;
+				uniforms.material_specular_tint = material.specular_tint;
+			}
+
+			// Visible meshlets
+			const auto &draw = mesh_buffers.get_draws(sub_mesh.lod)[i];
+			if (sub_mesh.command_count > 0)
+			{
+				auto offset = commands_data.offset + sub_mesh.first_command * sizeof(gl::draw_elements_indirect_command);
+				glMultiDrawElementsIndirect(
+					GL_TRIANGLES,
+					draw.index_type,
+					reinterpret_cast<const void*>(offset),
+					sub_mesh.command_count,
+					0
+					);
+				continue;
 			}
 
 			glDrawElementsBaseVertex(
 				GL_TRIANGLES,
-				mesh_data.draw_sizes[i],
-				GL_UNSIGNED_INT,            //! \todo this should be based on type provided by abd::mesh
-				nullptr,
-				mesh_data.base_indices[i]
+				draw.count,
+				draw.index_type,
+				reinterpret_cast<const void*>(draw.index_offset),
+				draw.base_vertex
 				);
 		}
 	}
 }
 
 
-void deferred_renderer::lighting_pass(std::vector<light_draw_task> &light_tasks, gl::synced_buffer_handle &lights_buffer_chunk, const abd::camera &camera)
+void deferred_renderer::lighting_pass(std::vector<light_draw_task> &light_tasks, const gl::stream_allocation &lights_data)
 {
 	abd::gl::debug_group d_shad(1, "abd::deferred_renderer shading pass");
+	auto &state = gl::state_cache::get();
 
 	// Attach the VAO
 	m_vao.bind();
 	
 	// Attach only color buffer and clear it
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+	state.bind_framebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
 	m_fbo.set_draw_buffers({GL_COLOR_ATTACHMENT0});
 
 	// Use shading program and bind G-buffer textures (standard layout)
-	//! \todo Uniform locations should only be retrieved once!
+	auto &uniforms = m_shading_uniforms;
 	m_shading_program->use();
-	glBindTextureUnit(1, m_gbuffer.position);
-	glBindTextureUnit(2, m_gbuffer.normal);
-	glBindTextureUnit(3, m_gbuffer.diffuse);
-	glBindTextureUnit(4, m_gbuffer.specular);
-	m_shading_program->get_uniform("tex_position") = 1;
-	m_shading_program->get_uniform("tex_normal")   = 2;
-	m_shading_program->get_uniform("tex_diffuse")  = 3;
-	m_shading_program->get_uniform("tex_specular") = 4;
-
-	// Matrices
-	m_shading_program->get_uniform("mat_view") = camera.get_view_matrix();
-	m_shading_program->get_uniform("mat_proj") = camera.get_projection_matrix();
-	m_shading_program->get_uniform("mat_vp")   = camera.get_matrix();
+	m_shading_bindings.bind();
+
+	// Light geometry is drawn without face culling
+	state.disable(GL_CULL_FACE);
 
 	// Additive blending
-	glBlendFunc(GL_SRC_COLOR, GL_DST_COLOR);
-	glBlendEquation(GL_FUNC_ADD);
-	glEnable(GL_BLEND);
+	state.blend_func(GL_SRC_COLOR, GL_DST_COLOR);
+	state.blend_equation(GL_FUNC_ADD);
+	state.enable(GL_BLEND);
 
-	// Bind the UBO to the program (at binding 0)
-	GLuint light_ub_id = glGetUniformBlockIndex(*m_shading_program, "LIGHTS_UBO");
-	if (light_ub_id == GL_INVALID_INDEX)
-		throw abd::exception("could not access UBO containing light data");
-	glUniformBlockBinding(*m_shading_program, light_ub_id, 0);
-	glBindBufferRange(GL_UNIFORM_BUFFER, 0, lights_buffer_chunk.get_buffer(), lights_buffer_chunk.get_offset(), lights_buffer_chunk.get_size());
+	// Bind the light data (binding point is set in the shader)
+	glBindBufferRange(GL_UNIFORM_BUFFER, lights_ubo_binding, *lights_data.buffer, lights_data.offset, lights_data.size);
 
 	// Count global lights
 	int global_light_count{0};
@@ -279,37 +664,66 @@ void deferred_renderer::lighting_pass(std::vector<light_draw_task> &light_tasks,
 	// Process global lights (if any)
 	if (global_light_count > 0)
 	{
-		glDisable(GL_DEPTH_TEST);
-		glDepthMask(GL_FALSE);
+		state.disable(GL_DEPTH_TEST);
+		state.depth_mask(GL_FALSE);
 
 		m_vao.bind_buffer(0, m_blit_quad, {0, 3 * sizeof(float)});
-		m_shading_program->get_uniform("base_light_index") = 0;
-		m_shading_program->get_uniform("light_count") = global_light_count;
+		uniforms.base_light_index = 0;
+		uniforms.light_count = global_light_count;
 		glDrawArrays(GL_TRIANGLES, 0, 6);
 	}
 
 
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LEQUAL);
-	glDepthMask(GL_FALSE);
+	state.enable(GL_DEPTH_TEST);
+	state.depth_func(GL_LEQUAL);
+	state.depth_mask(GL_FALSE);
 
 	//! \todo Light volume processing here
+}
 
-	lights_buffer_chunk.flush();
-	lights_buffer_chunk.fence();
+/**
+	Builds a log-luminance histogram of the color buffer and adapts exposure
+	towards its average. The result stays in m_exposure_buffer and is consumed
+	by the postprocess shader, so there is no readback.
+*/
+void deferred_renderer::exposure_pass(float dt)
+{
+	abd::gl::debug_group d(2, "abd::deferred_renderer exposure pass");
+
+	// Both programs share these bindings
+	m_exposure_bindings.bind();
+
+	// Histogram - one 16x16 work group per screen tile
+	m_histogram_program->use();
+	m_histogram_uniforms.min_log_luminance = min_log_luminance;
+	m_histogram_uniforms.inv_log_luminance_range = 1.f / log_luminance_range;
+	glDispatchCompute((m_fbo_width + 15) / 16, (m_fbo_height + 15) / 16, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// Average and adaptation - a single work group
+	m_exposure_program->use();
+	m_exposure_uniforms.min_log_luminance = min_log_luminance;
+	m_exposure_uniforms.log_luminance_range = log_luminance_range;
+	m_exposure_uniforms.pixel_count = m_fbo_width * m_fbo_height;
+	m_exposure_uniforms.adaptation_rate = 1.f - std::exp(-dt * exposure_adaptation_speed);
+	m_exposure_uniforms.exposure_key = exposure_key;
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
 void deferred_renderer::postprocess_to_output(GLuint output_fbo)
 {
+	auto &state = gl::state_cache::get();
+
 	// Postprocess color buffer and output it to the output FBO
 	// Attach the blit quad to the VAO, disable depth test and blending
 	m_vao.bind_buffer(0, m_blit_quad, {0, 3 * sizeof(float)});
-	glDisable(GL_DEPTH_TEST);
-	glDepthMask(GL_FALSE);
-	glDisable(GL_BLEND);
+	state.disable(GL_DEPTH_TEST);
+	state.depth_mask(GL_FALSE);
+	state.disable(GL_BLEND);
+	state.disable(GL_CULL_FACE);
 	m_postprocess_program->use();
-	m_postprocess_program->get_uniform("input_tex") = 0;
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, output_fbo);
-	glBindTextureUnit(0, m_color_buffer);
+	m_postprocess_bindings.bind();
+	state.bind_framebuffer(GL_DRAW_FRAMEBUFFER, output_fbo);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 }
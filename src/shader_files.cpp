@@ -0,0 +1,119 @@
+#include <albedo/shader_files.hpp>
+#include <albedo/exception.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+using abd::shader_files;
+
+//! Normalized path used for comparisons with embedded paths
+static std::string normalize(const boost::filesystem::path &path)
+{
+	auto normal = path.lexically_normal().generic_string();
+	if (normal == ".") return "";
+
+	if (normal.compare(0, 2, "./") == 0)
+		normal.erase(0, 2);
+
+	// Trailing separator
+	if (normal.size() >= 2 && normal.compare(normal.size() - 2, 2, "/.") == 0)
+		normal.resize(normal.size() - 2);
+
+	return normal;
+}
+
+shader_files::shader_files(boost::filesystem::path root) :
+	m_root(std::move(root))
+{
+}
+
+shader_files::shader_files(std::nullopt_t) :
+	m_root(std::nullopt)
+{
+}
+
+shader_files shader_files::embedded()
+{
+	return shader_files(std::nullopt);
+}
+
+/**
+	Returns the renderer's own shaders - the embedded ones, unless the
+	ALBEDO_SHADER_DIR environment variable points to the albedo/ shader
+	directory, in which case the shaders are read from disk (for development).
+*/
+shader_files shader_files::albedo_shaders()
+{
+	if (auto dir = std::getenv("ALBEDO_SHADER_DIR"); dir && *dir)
+		return shader_files(boost::filesystem::path(dir));
+	else
+		return embedded();
+}
+
+std::optional<std::string> shader_files::read(const boost::filesystem::path &path) const
+{
+	if (m_root)
+	{
+		std::ifstream f{(*m_root / path).string()};
+		if (!f) return {};
+		return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	}
+
+	auto name = normalize(path);
+	for (std::size_t i = 0; i < embedded_shader_count; i++)
+		if (embedded_shaders[i].path == name)
+			return std::string(embedded_shaders[i].contents);
+
+	return {};
+}
+
+/**
+	Returns the SPIR-V module built from the shader source. Only embedded
+	shaders have SPIR-V - files on disk may have been modified since the build.
+*/
+std::optional<std::string_view> shader_files::read_spirv(const boost::filesystem::path &path) const
+{
+	if (m_root) return {};
+
+	auto name = normalize(path);
+	for (std::size_t i = 0; i < embedded_spirv_count; i++)
+		if (embedded_spirv[i].path == name)
+			return embedded_spirv[i].contents;
+
+	return {};
+}
+
+/**
+	Returns sorted paths of all files in the directory (not recursively)
+*/
+std::vector<boost::filesystem::path> shader_files::list(const boost::filesystem::path &dir) const
+{
+	std::vector<boost::filesystem::path> paths;
+
+	if (m_root)
+	{
+		using namespace boost::filesystem;
+
+		if (!is_directory(*m_root / dir))
+			throw abd::exception("shader dir does not exist");
+
+		for (auto &entry : boost::make_iterator_range(directory_iterator(*m_root / dir), {}))
+			if (is_regular_file(entry.path()))
+				paths.push_back(dir / entry.path().filename());
+	}
+	else
+	{
+		auto name = normalize(dir);
+		for (std::size_t i = 0; i < embedded_shader_count; i++)
+		{
+			boost::filesystem::path path{std::string(embedded_shaders[i].path)};
+			if (normalize(path.parent_path()) == name)
+				paths.push_back(path);
+		}
+	}
+
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
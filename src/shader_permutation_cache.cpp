@@ -0,0 +1,315 @@
+#include <albedo/shader_permutation_cache.hpp>
+#include <albedo/simple_loaders.hpp>
+#include <albedo/utils.hpp>
+#include <algorithm>
+#include <cstring>
+#include <regex>
+
+using abd::shader_permutation_cache;
+
+shader_permutation_cache::shader_permutation_cache(shader_preprocessor preprocessor, program_binary_cache *binary_cache, bool use_spirv) :
+	m_preprocessor(std::move(preprocessor)),
+	m_binary_cache(binary_cache),
+	m_use_spirv(use_spirv && gl::has_spirv_support())
+{
+}
+
+/**
+	Submits the variant for compilation (unless it's known already)
+	without waiting for the result
+*/
+void shader_permutation_cache::submit(const boost::filesystem::path &program_dir, const std::vector<std::string> &defines)
+{
+	find_variant(program_dir, defines);
+}
+
+/**
+	Returns true if get() won't block (see gl::deferred_program::is_ready()).
+	Submits the variant if it's not known yet.
+*/
+bool shader_permutation_cache::is_ready(const boost::filesystem::path &program_dir, const std::vector<std::string> &defines)
+{
+	auto &entry = find_variant(program_dir, defines);
+	if (entry.pending && !entry.fallback_sources.empty() && entry.pending->is_ready())
+		finish_spirv(entry);
+
+	return !entry.pending || entry.pending->is_ready();
+}
+
+/**
+	Returns the variant, compiling it first if necessary.
+	Compilation errors are thrown as gl::shader_exception.
+*/
+abd::gl::program &shader_permutation_cache::get(const boost::filesystem::path &program_dir, const std::vector<std::string> &defines)
+{
+	auto &entry = find_variant(program_dir, defines);
+	if (entry.pending && !entry.fallback_sources.empty())
+		finish_spirv(entry);
+
+	if (entry.pending)
+	{
+		// Failed programs are discarded, so they can be submitted again
+		auto pending = std::move(*entry.pending);
+		entry.pending.reset();
+		entry.program = std::make_unique<gl::program>(pending.finish());
+	}
+
+	return *entry.program;
+}
+
+/**
+	Finishes a SPIR-V program. If it fails to link, its GLSL sources
+	are submitted for compilation instead.
+*/
+void shader_permutation_cache::finish_spirv(program_entry &entry)
+{
+	auto pending = std::move(*entry.pending);
+	entry.pending.reset();
+
+	try
+	{
+		entry.program = std::make_unique<gl::program>(pending.finish());
+	}
+	catch (const gl::shader_exception &)
+	{
+		entry.pending.emplace(submit_sources(entry.fallback_sources));
+	}
+
+	entry.fallback_sources.clear();
+}
+
+abd::gl::deferred_program shader_permutation_cache::submit_sources(const std::vector<shader_source> &sources)
+{
+	return m_binary_cache ? m_binary_cache->submit_program(sources) : abd::simple_submit_program(sources);
+}
+
+shader_permutation_cache::program_entry &shader_permutation_cache::find_variant(const boost::filesystem::path &program_dir, const std::vector<std::string> &defines)
+{
+	// Normalized define set
+	std::vector<std::string> sorted_defines(defines);
+	std::sort(sorted_defines.begin(), sorted_defines.end());
+	sorted_defines.erase(std::unique(sorted_defines.begin(), sorted_defines.end()), sorted_defines.end());
+
+	auto variant_key = std::make_pair(program_dir.string(), sorted_defines);
+	auto variant = m_variants.find(variant_key);
+	if (variant != m_variants.end() && (variant->second->pending || variant->second->program))
+		return *variant->second;
+
+	auto sources = m_preprocessor.process(get_sources(program_dir), sorted_defines);
+
+	// SPIR-V is used if all defines can be specialization constants
+	std::optional<std::vector<gl::specialization_constant>> constants;
+	auto spirv = get_spirv(program_dir);
+	if (spirv)
+		constants = specialize(*spirv, sorted_defines, sources);
+
+	// Identical preprocessed sources (or SPIR-V modules and constants) share the program
+	std::uint64_t hash = constants ? hash_spirv(*spirv, *constants) : hash_sources(sources);
+
+	// Decided once per program directory - its first SPIR-V program
+	// is linked right away (unless an identical one exists already)
+	std::unique_ptr<gl::program> checked_program;
+	if (constants && !spirv->checked && !has_program(hash))
+	{
+		spirv->checked = true;
+		checked_program = check_spirv_support(*spirv, *constants);
+		if (!checked_program)
+		{
+			m_spirv[program_dir.string()].reset();
+			constants.reset();
+			hash = hash_sources(sources);
+		}
+	}
+
+	auto &entry = m_programs[hash];
+	if (!entry)
+		entry = std::make_unique<program_entry>();
+
+	if (!entry->pending && !entry->program)
+	{
+		if (checked_program)
+			entry->program = std::move(checked_program);
+		else if (constants)
+		{
+			entry->pending.emplace(make_spirv_shaders(*spirv, *constants));
+			entry->fallback_sources = std::move(sources);
+		}
+		else
+			entry->pending.emplace(submit_sources(sources));
+	}
+
+	m_variants[variant_key] = entry.get();
+	return *entry;
+}
+
+bool shader_permutation_cache::has_program(std::uint64_t hash) const
+{
+	auto it = m_programs.find(hash);
+	return it != m_programs.end() && (it->second->pending || it->second->program);
+}
+
+std::uint64_t shader_permutation_cache::hash_sources(const std::vector<shader_source> &sources)
+{
+	abd::fnv1a_hash hash;
+	for (const auto &source : sources)
+	{
+		hash.add(&source.type, sizeof(source.type));
+		hash.add(source.source);
+	}
+
+	return hash.get();
+}
+
+std::uint64_t shader_permutation_cache::hash_spirv(const spirv_program &spirv, const std::vector<gl::specialization_constant> &constants)
+{
+	abd::fnv1a_hash hash;
+	hash.add("spirv");
+	for (const auto &[type, module] : spirv.modules)
+	{
+		hash.add(&type, sizeof(type));
+		hash.add(module.data(), module.size());
+	}
+
+	for (const auto &c : constants)
+	{
+		hash.add(&c.id, sizeof(c.id));
+		hash.add(&c.value, sizeof(c.value));
+	}
+
+	return hash.get();
+}
+
+const std::vector<abd::shader_source> &shader_permutation_cache::get_sources(const boost::filesystem::path &program_dir)
+{
+	auto it = m_sources.find(program_dir.string());
+	if (it == m_sources.end())
+		it = m_sources.emplace(program_dir.string(), abd::simple_read_shader_dir(program_dir, m_preprocessor.get_files())).first;
+
+	return it->second;
+}
+
+/**
+	Returns SPIR-V modules of the program or nullptr if SPIR-V isn't
+	available for all of its stages (or isn't usable for the program)
+*/
+shader_permutation_cache::spirv_program *shader_permutation_cache::get_spirv(const boost::filesystem::path &program_dir)
+{
+	if (!m_use_spirv) return nullptr;
+
+	auto it = m_spirv.find(program_dir.string());
+	if (it == m_spirv.end())
+	{
+		std::optional<spirv_program> spirv{spirv_program{}};
+		const auto &files = m_preprocessor.get_files();
+		static const std::regex constant_regex{R"(layout\s*\(\s*constant_id\s*=\s*(\d+)\s*\)\s*const\s+(\w+)\s+(\w+))"};
+
+		for (const auto &source : get_sources(program_dir))
+		{
+			auto module = files.read_spirv(source.path);
+			if (!module)
+			{
+				spirv.reset();
+				break;
+			}
+
+			spirv->modules.emplace_back(source.type, *module);
+
+			// Specialization constant declarations (includes expanded)
+			auto expanded = m_preprocessor.process(source).source;
+			for (std::sregex_iterator match{expanded.begin(), expanded.end(), constant_regex}, end; match != end; ++match)
+				spirv->constants[(*match)[3]] = spirv_constant{static_cast<GLuint>(std::stoul((*match)[1])), (*match)[2]};
+		}
+
+		it = m_spirv.emplace(program_dir.string(), std::move(spirv)).first;
+	}
+
+	return it->second ? &*it->second : nullptr;
+}
+
+std::vector<abd::gl::shader> shader_permutation_cache::make_spirv_shaders(const spirv_program &spirv, const std::vector<gl::specialization_constant> &constants)
+{
+	std::vector<gl::shader> shaders;
+	for (const auto &[type, module] : spirv.modules)
+		shaders.emplace_back(type, module.data(), module.size(), constants, gl::deferred_compile);
+
+	return shaders;
+}
+
+/**
+	Links the SPIR-V program and checks whether the driver reflects uniform
+	names. If it does, returns the program. Otherwise, returns nullptr.
+	Linking SPIR-V doesn't involve the GLSL compiler, so this doesn't take long.
+*/
+std::unique_ptr<abd::gl::program> shader_permutation_cache::check_spirv_support(const spirv_program &spirv, const std::vector<gl::specialization_constant> &constants)
+{
+	try
+	{
+		auto program = gl::deferred_program(make_spirv_shaders(spirv, constants)).finish();
+		if (!program.get_uniforms().count("") && !program.get_uniform_blocks().count(""))
+			return std::make_unique<gl::program>(std::move(program));
+	}
+	catch (const gl::shader_exception &)
+	{
+	}
+
+	return {};
+}
+
+/**
+	Converts defines to specialization constants. Returns nothing if any
+	define the program uses isn't a specialization constant.
+*/
+std::optional<std::vector<abd::gl::specialization_constant>> shader_permutation_cache::specialize(const spirv_program &spirv, const std::vector<std::string> &defines, const std::vector<shader_source> &sources)
+{
+	std::vector<gl::specialization_constant> constants;
+	for (const auto &define : defines)
+	{
+		auto name_end = define.find_first_of(" \t(");
+		std::string name = define.substr(0, name_end);
+		std::string value;
+		if (name_end != std::string::npos)
+		{
+			auto value_begin = define.find_first_not_of(" \t", name_end);
+			if (value_begin != std::string::npos)
+				value = define.substr(value_begin);
+		}
+
+		auto constant = spirv.constants.find(name);
+		if (constant == spirv.constants.end())
+		{
+			// The preprocessor only injects defines the program references
+			for (const auto &source : sources)
+				if (source.source.find("#define " + define + "\n") != std::string::npos)
+					return {};
+
+			continue;
+		}
+
+		GLuint bits;
+		const auto &type = constant->second.type;
+		try
+		{
+			if (type == "int")
+				bits = static_cast<GLuint>(std::stoi(value));
+			else if (type == "uint")
+				bits = static_cast<GLuint>(std::stoul(value));
+			else if (type == "float")
+			{
+				float f = std::stof(value);
+				std::memcpy(&bits, &f, sizeof(bits));
+			}
+			else if (type == "bool")
+				bits = value.empty() || value == "true" || value == "1";
+			else
+				throw abd::exception("unsupported type of specialization constant " + name);
+		}
+		catch (const std::logic_error &)
+		{
+			throw abd::exception("invalid value of specialization constant " + name + ": " + value);
+		}
+
+		constants.push_back({constant->second.id, bits});
+	}
+
+	return constants;
+}
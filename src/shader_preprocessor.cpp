@@ -0,0 +1,171 @@
+#include <albedo/shader_preprocessor.hpp>
+#include <albedo/exception.hpp>
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+using abd::shader_preprocessor;
+
+//! Key identifying a file, so it's included only once
+static std::string file_key(const boost::filesystem::path &path)
+{
+	return path.lexically_normal().generic_string();
+}
+
+static bool is_identifier_char(char c)
+{
+	return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+/**
+	Returns all identifiers appearing in the source
+*/
+static std::set<std::string> find_identifiers(const std::string &source)
+{
+	std::set<std::string> identifiers;
+	for (std::size_t i = 0; i < source.size();)
+	{
+		if (!is_identifier_char(source[i]))
+		{
+			i++;
+			continue;
+		}
+
+		std::size_t begin = i;
+		while (i < source.size() && is_identifier_char(source[i])) i++;
+		if (!std::isdigit(static_cast<unsigned char>(source[begin])))
+			identifiers.insert(source.substr(begin, i - begin));
+	}
+
+	return identifiers;
+}
+
+shader_preprocessor::shader_preprocessor(std::vector<boost::filesystem::path> include_dirs, shader_files files) :
+	m_include_dirs(std::move(include_dirs)),
+	m_files(std::move(files))
+{
+}
+
+abd::shader_source shader_preprocessor::process(const shader_source &source, const std::vector<std::string> &defines) const
+{
+	expansion state;
+	if (!source.path.empty())
+		state.included.insert(file_key(source.path));
+
+	expand(source.source, source.path, 0, 0, state);
+	const std::string &expanded = state.output;
+
+	// Defines referenced by the shader
+	auto identifiers = find_identifiers(expanded);
+	std::vector<std::string> used_defines;
+	for (const auto &define : defines)
+	{
+		std::string name = define.substr(0, define.find_first_of(" \t("));
+		if (identifiers.count(name))
+			used_defines.push_back(define);
+	}
+
+	// Sorted, so the order in which defines are given doesn't matter
+	std::sort(used_defines.begin(), used_defines.end());
+	used_defines.erase(std::unique(used_defines.begin(), used_defines.end()), used_defines.end());
+
+	shader_source result{source.type, {}, source.path};
+	if (used_defines.empty())
+	{
+		result.source = expanded;
+		return result;
+	}
+
+	// Insert after the #version directive (or at the beginning if there's none)
+	std::size_t pos = 0;
+	auto version = expanded.find("#version");
+	if (version != std::string::npos)
+	{
+		pos = expanded.find('\n', version);
+		pos = pos == std::string::npos ? expanded.size() : pos + 1;
+	}
+
+	std::string directives;
+	for (const auto &define : used_defines)
+		directives += "#define " + define + "\n";
+
+	// Keep line numbers in compilation logs correct
+	directives += "#line " + std::to_string(std::count(expanded.begin(), expanded.begin() + pos, '\n') + 1) + " 0\n";
+
+	result.source = expanded.substr(0, pos) + directives + expanded.substr(pos);
+	return result;
+}
+
+std::vector<abd::shader_source> shader_preprocessor::process(const std::vector<shader_source> &sources, const std::vector<std::string> &defines) const
+{
+	std::vector<shader_source> result;
+	for (const auto &source : sources)
+		result.push_back(process(source, defines));
+	return result;
+}
+
+std::pair<boost::filesystem::path, std::string> shader_preprocessor::resolve_include(const std::string &name, bool system, const boost::filesystem::path &including_path) const
+{
+	if (!system && !including_path.empty())
+	{
+		auto path = including_path.parent_path() / name;
+		if (auto contents = m_files.read(path))
+			return {path, std::move(*contents)};
+	}
+
+	for (const auto &dir : m_include_dirs)
+	{
+		auto path = dir / name;
+		if (auto contents = m_files.read(path))
+			return {path, std::move(*contents)};
+	}
+
+	throw abd::exception("could not find shader include file " + name + " (included from " + including_path.string() + ")");
+}
+
+/**
+	Copies the source to the output, recursively replacing #include
+	directives with contents of the included files
+*/
+void shader_preprocessor::expand(const std::string &source, const boost::filesystem::path &path, int source_index, int depth, expansion &state) const
+{
+	if (depth > max_include_depth)
+		throw abd::exception("shader includes nested too deeply in " + path.string());
+
+	std::istringstream in(source);
+	std::string line;
+	for (int line_number = 1; std::getline(in, line); line_number++)
+	{
+		auto directive = line.find_first_not_of(" \t");
+		if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+		{
+			state.output += line;
+			state.output += '\n';
+			continue;
+		}
+
+		// File name in quotes or angle brackets
+		auto begin = line.find_first_of("\"<", directive + 8);
+		if (begin == std::string::npos)
+			throw abd::exception("invalid #include directive in " + path.string() + ":" + std::to_string(line_number));
+
+		bool system = line[begin] == '<';
+		auto end = line.find(system ? '>' : '"', begin + 1);
+		if (end == std::string::npos)
+			throw abd::exception("invalid #include directive in " + path.string() + ":" + std::to_string(line_number));
+
+		auto [include_path, contents] = resolve_include(line.substr(begin + 1, end - begin - 1), system, path);
+
+		// Already included - keep the line count
+		if (!state.included.insert(file_key(include_path)).second)
+		{
+			state.output += '\n';
+			continue;
+		}
+
+		int index = ++state.file_count;
+		state.output += "#line 1 " + std::to_string(index) + "\n";
+		expand(contents, include_path, index, depth + 1, state);
+		state.output += "#line " + std::to_string(line_number + 1) + " " + std::to_string(source_index) + "\n";
+	}
+}
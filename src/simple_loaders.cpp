@@ -7,11 +7,15 @@
 #include <string>
 #include <algorithm>
 #include <iostream>
-#include <boost/range/iterator_range.hpp>
 
-abd::mesh_data abd::assimp_simple_load_mesh(const boost::filesystem::path &path)
+abd::mesh_data abd::assimp_simple_load_mesh(const boost::filesystem::path &path, const std::optional<mesh_optimizer_options> &optimizer, const std::optional<mesh_lod_options> &lods, const std::optional<meshlet_options> &meshlets, std::vector<sub_mesh_optimization_report> *optimization_report)
 {
 	Assimp::Importer importer;
+	return assimp_simple_load_mesh(importer, path, optimizer, lods, meshlets, optimization_report);
+}
+
+abd::mesh_data abd::assimp_simple_load_mesh(Assimp::Importer &importer, const boost::filesystem::path &path, const std::optional<mesh_optimizer_options> &optimizer, const std::optional<mesh_lod_options> &lods, const std::optional<meshlet_options> &meshlets, std::vector<sub_mesh_optimization_report> *optimization_report)
+{
 	const aiScene *scene = importer.ReadFile(path.string(), aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals);
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 	{
@@ -64,8 +68,9 @@ abd::mesh_data abd::assimp_simple_load_mesh(const boost::filesystem::path &path)
 	// Appends aiMesh to the mesh we're working on
 	auto process_mesh = [&](aiMesh *mesh)
 	{
-		// Register new base index
+		// Register new base index and base vertex (indices are relative to it)
 		mesh_data.base_indices.push_back(mesh_data.indices.size());
+		mesh_data.base_vertices.push_back(mesh_data.positions.size());
 
 		// Process vertices
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -131,6 +136,26 @@ abd::mesh_data abd::assimp_simple_load_mesh(const boost::filesystem::path &path)
 	};
 
 	process_node(scene, scene->mRootNode);
+
+	// Simplified versions of all sub-meshes
+	if (lods)
+		abd::generate_lods(mesh_data, *lods);
+
+	// Reorder triangles and vertices
+	if (optimizer)
+	{
+		auto report = abd::optimize_mesh(mesh_data, *optimizer);
+		if (optimization_report)
+			*optimization_report = std::move(report);
+	}
+
+	// Clusters are built from already optimized triangle order
+	if (meshlets)
+		abd::build_meshlets(mesh_data, *meshlets);
+
+	// The scene is not needed anymore - don't keep it until the next import
+	importer.FreeScene();
+
 	return mesh_data;
 }
 
@@ -145,19 +170,12 @@ abd::gl::shader abd::simple_load_shader(GLenum type, const boost::filesystem::pa
 	return abd::gl::shader(type, src);
 }
 
-abd::gl::program abd::simple_load_shader_dir(const boost::filesystem::path &dir)
+/**
+	Reads sources of all shaders in the directory. The shaders are sorted by
+	file name, so the result doesn't depend on directory iteration order.
+*/
+std::vector<abd::shader_source> abd::simple_read_shader_dir(const boost::filesystem::path &dir, const shader_files &files)
 {
-	using namespace boost::filesystem;
-
-	if (!exists(dir))
-		throw abd::exception("shader dir does not exist");
-
-	if (!is_directory(dir))
-		throw abd::exception("shader program must be provided in a directory on its own");
-
-	// Loaded shaders
-	std::vector<abd::gl::shader> shaders;
-
 	// Shader extensions mapped to shader types
 	static const std::unordered_map<std::string, GLenum> shader_types = {
 		{".vs", GL_VERTEX_SHADER},
@@ -168,31 +186,41 @@ abd::gl::program abd::simple_load_shader_dir(const boost::filesystem::path &dir)
 		{".gs", GL_GEOMETRY_SHADER},
 	};
 
-	// Iterate over directory contents
-	for (auto &entry : boost::make_iterator_range(directory_iterator(dir), {}))
+	std::vector<abd::shader_source> sources;
+	for (const auto &path : files.list(dir))
 	{
-		auto path = entry.path();
-
 		// If the path end with .glsl, it's likely a hit
-		if (is_regular_file(path) && path.extension() == ".glsl")
-		{
-			auto shader_type_str = path.stem().extension().string();
+		if (path.extension() != ".glsl" || !shader_types.count(path.stem().extension().string()))
+			continue;
 
-			try
-			{
-				GLenum type = shader_types.at(shader_type_str);
-				shaders.emplace_back(simple_load_shader(type, path));
-			}
-			catch (const std::out_of_range &ex)
-			{
-				// Ignore
-			}
-		}
+		auto source = files.read(path);
+		if (!source) throw abd::exception("could not open shader source file");
+
+		sources.push_back({shader_types.at(path.stem().extension().string()), std::move(*source), path});
 	}
 
 	// Did not find any shaders
-	if (shaders.empty())
+	if (sources.empty())
 		throw abd::exception("could not find any shaders in the provided directory");
 
-	return abd::gl::program(shaders);
-}
\ No newline at end of file
+	return sources;
+}
+
+abd::gl::deferred_program abd::simple_submit_program(const std::vector<shader_source> &sources, abd::gl::deferred_program::link_callback on_link)
+{
+	std::vector<abd::gl::shader> shaders;
+	for (const auto &source : sources)
+		shaders.emplace_back(source.type, source.source, abd::gl::deferred_compile);
+
+	return abd::gl::deferred_program(std::move(shaders), std::move(on_link));
+}
+
+abd::gl::program abd::simple_build_program(const std::vector<shader_source> &sources)
+{
+	return simple_submit_program(sources).finish();
+}
+
+abd::gl::program abd::simple_load_shader_dir(const boost::filesystem::path &dir, const shader_preprocessor &preprocessor)
+{
+	return simple_build_program(preprocessor.process(simple_read_shader_dir(dir, preprocessor.get_files())));
+}
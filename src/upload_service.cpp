@@ -0,0 +1,239 @@
+#include <albedo/upload_service.hpp>
+#include <algorithm>
+#include <cstring>
+
+using abd::upload_service;
+
+/**
+	Creates a hidden window sharing context with the main window
+	and starts the worker thread.
+*/
+upload_service::upload_service(gl::window &main_window, GLsizeiptr staging_size) :
+	m_staging_size(staging_size),
+	m_context_window(1, 1, "abd::upload_service", gl::window_builder{}.visible(false).parent_window(main_window.get()))
+{
+	// Creating the window made its context current - restore the main one
+	main_window.make_current();
+
+	m_worker = std::thread(&upload_service::worker_main, this);
+}
+
+upload_service::~upload_service()
+{
+	{
+		std::lock_guard lock{m_mutex};
+		m_stop = true;
+	}
+
+	m_cv.notify_all();
+	m_worker.join();
+}
+
+/**
+	Schedules mesh upload. The mesh is created once the upload
+	is complete and poll() is called.
+*/
+std::future<std::shared_ptr<abd::mesh>> upload_service::upload_mesh(abd::mesh_data &&data, vertex_layout layout)
+{
+	struct mesh_job
+	{
+		abd::mesh_data data;
+		std::unique_ptr<abd::mesh_buffers> buffers;
+		std::promise<std::shared_ptr<abd::mesh>> promise;
+	};
+
+	auto job = std::make_shared<mesh_job>();
+	job->data = std::move(data);
+	auto future = job->promise.get_future();
+
+	std::lock_guard lock{m_mutex};
+	m_jobs.emplace_back([this, job, layout]()
+	{
+		try
+		{
+			job->buffers = std::make_unique<abd::mesh_buffers>(job->data, [this](const void *ptr, GLsizeiptr size, GLbitfield flags)
+			{
+				return this->stage_buffer(ptr, size, flags);
+			}, layout);
+		}
+		catch (...)
+		{
+			job->promise.set_exception(std::current_exception());
+			return;
+		}
+
+		complete([job]()
+		{
+			job->promise.set_value(std::make_shared<abd::mesh>(std::move(job->data), std::move(job->buffers)));
+		});
+	});
+	m_cv.notify_one();
+
+	return future;
+}
+
+/**
+	Schedules texture upload. If the texture has more than one level,
+	mipmaps are generated after the upload.
+*/
+std::future<std::shared_ptr<abd::texture_2d>> upload_service::upload_texture_2d(texture_2d_data &&data)
+{
+	struct texture_job
+	{
+		texture_2d_data data;
+		std::shared_ptr<abd::texture_2d> texture;
+		std::promise<std::shared_ptr<abd::texture_2d>> promise;
+	};
+
+	auto job = std::make_shared<texture_job>();
+	job->data = std::move(data);
+	auto future = job->promise.get_future();
+
+	std::lock_guard lock{m_mutex};
+	m_jobs.emplace_back([this, job]()
+	{
+		try
+		{
+			auto &data = job->data;
+			auto texture = std::make_shared<abd::texture_2d>();
+			texture->storage_2d(data.internal_format, data.width, data.height, std::max(data.levels, 1));
+
+			// Go through the staging buffer only if the image fits in it
+			GLsizeiptr size = data.pixels.size();
+			if (size <= m_staging->get_frame_size() - m_staging->get_used_size())
+			{
+				auto staging = m_staging->allocate(size, 16);
+				std::memcpy(staging.ptr, data.pixels.data(), size);
+				m_staging->flush();
+
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, *staging.buffer);
+				texture->subimage_2d(0, 0, 0, data.width, data.height, data.format, data.type, reinterpret_cast<const void*>(staging.offset));
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			}
+			else
+			{
+				texture->subimage_2d(0, 0, 0, data.width, data.height, data.format, data.type, data.pixels.data());
+			}
+
+			if (data.levels > 1)
+				texture->generate_mipmap();
+
+			job->texture = std::move(texture);
+			data.pixels.clear();
+		}
+		catch (...)
+		{
+			job->promise.set_exception(std::current_exception());
+			return;
+		}
+
+		complete([job]()
+		{
+			job->promise.set_value(std::move(job->texture));
+		});
+	});
+	m_cv.notify_one();
+
+	return future;
+}
+
+/**
+	Hands out all uploads whose fences have signaled.
+	Should be called by the render thread once per frame.
+*/
+void upload_service::poll()
+{
+	std::vector<completion> ready;
+
+	{
+		std::lock_guard lock{m_mutex};
+		auto it = std::partition(m_completions.begin(), m_completions.end(), [](const completion &c)
+		{
+			return !c.fence.is_signaled();
+		});
+
+		std::move(it, m_completions.end(), std::back_inserter(ready));
+		m_completions.erase(it, m_completions.end());
+	}
+
+	for (auto &c : ready)
+		c.callback();
+}
+
+/**
+	Worker thread - executes jobs with the shared context current
+*/
+void upload_service::worker_main()
+{
+	m_context_window.make_current();
+	m_staging = std::make_unique<gl::stream_buffer>(m_staging_size);
+
+	while (true)
+	{
+		std::function<void()> job;
+
+		{
+			std::unique_lock lock{m_mutex};
+			m_cv.wait(lock, [this]{return m_stop || !m_jobs.empty();});
+			if (m_stop) break;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		// Each job gets a fresh staging chunk
+		m_staging->begin_frame();
+		job();
+		m_staging->end_frame();
+	}
+
+	// GL objects owned by the worker must be released while its context is current
+	m_staging.reset();
+	glfwMakeContextCurrent(nullptr);
+}
+
+/**
+	Fences all commands issued by the current job and registers
+	callback to be executed once the fence signals.
+*/
+void upload_service::complete(std::function<void()> callback)
+{
+	completion c{gl::fence_sync{}, std::move(callback)};
+	c.fence.fence();
+
+	// Make sure the commands are actually submitted (the render thread cannot flush them)
+	glFlush();
+
+	std::lock_guard lock{m_mutex};
+	m_completions.push_back(std::move(c));
+}
+
+/**
+	Creates a GPU buffer and copies the data into it through the staging buffer.
+	Data larger than a staging chunk is uploaded in pieces.
+*/
+std::unique_ptr<abd::gl::buffer> upload_service::stage_buffer(const void *data, GLsizeiptr size, GLbitfield flags)
+{
+	auto buffer = std::make_unique<gl::buffer>(size, nullptr, flags);
+
+	for (GLsizeiptr done = 0; done < size;)
+	{
+		// Start a new chunk if the current one is full
+		GLsizeiptr piece = std::min(size - done, m_staging->get_frame_size() - m_staging->get_used_size());
+		if (piece <= 0)
+		{
+			m_staging->end_frame();
+			m_staging->begin_frame();
+			continue;
+		}
+
+		auto staging = m_staging->allocate(piece, 1);
+		std::memcpy(staging.ptr, static_cast<const char*>(data) + done, piece);
+		m_staging->flush();
+
+		glCopyNamedBufferSubData(*staging.buffer, *buffer, staging.offset, done, piece);
+		done += piece;
+	}
+
+	return buffer;
+}
@@ -0,0 +1,32 @@
+#include <albedo/vertex_format.hpp>
+#include <limits>
+
+using abd::vertex_quantization;
+
+/**
+	Computes quantization parameters mapping the bounding box
+	of the positions onto [-1; 1] cube
+*/
+vertex_quantization vertex_quantization::from_positions(const std::vector<glm::vec3> &positions)
+{
+	vertex_quantization q;
+	if (positions.empty()) return q;
+
+	glm::vec3 min{std::numeric_limits<float>::max()};
+	glm::vec3 max{std::numeric_limits<float>::lowest()};
+	for (const auto &p : positions)
+	{
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+
+	q.position_bias = (min + max) * 0.5f;
+	q.position_scale = (max - min) * 0.5f;
+
+	// Avoid division by zero for flat meshes
+	for (int i = 0; i < 3; i++)
+		if (q.position_scale[i] <= 0.f)
+			q.position_scale[i] = 1.f;
+
+	return q;
+}
@@ -0,0 +1,79 @@
+#include <albedo/baked_mesh.hpp>
+#include <albedo/simple_loaders.hpp>
+#include <iostream>
+#include <string>
+
+/**
+	\file Offline mesh baker - imports a mesh with Assimp, runs the whole
+	processing pipeline and writes the result as a baked mesh.
+
+	Usage: albedo_bake [options] <input> <output>
+		--layout separate|interleaved|compact
+		--no-lods
+		--no-optimize
+		--no-meshlets
+*/
+
+static void usage(const char *argv0)
+{
+	std::cerr << "Usage: " << argv0 << " [--layout separate|interleaved|compact] [--no-lods] [--no-optimize] [--no-meshlets] <input> <output>" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	abd::vertex_layout layout = abd::vertex_layout::SEPARATE;
+	std::optional<abd::mesh_optimizer_options> optimizer = abd::mesh_optimizer_options{};
+	std::optional<abd::mesh_lod_options> lods = abd::mesh_lod_options{};
+	std::optional<abd::meshlet_options> meshlets = abd::meshlet_options{};
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--layout" && i + 1 < argc)
+		{
+			std::string name = argv[++i];
+			if (name == "separate") layout = abd::vertex_layout::SEPARATE;
+			else if (name == "interleaved") layout = abd::vertex_layout::INTERLEAVED;
+			else if (name == "compact") layout = abd::vertex_layout::COMPACT;
+			else
+			{
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		else if (arg == "--no-lods") lods.reset();
+		else if (arg == "--no-optimize") optimizer.reset();
+		else if (arg == "--no-meshlets") meshlets.reset();
+		else if (arg.size() > 1 && arg[0] == '-')
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		else
+			paths.push_back(arg);
+	}
+
+	if (paths.size() != 2)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	try
+	{
+		std::vector<abd::sub_mesh_optimization_report> report;
+		auto data = abd::assimp_simple_load_mesh(paths[0], optimizer, lods, meshlets, &report);
+		for (std::size_t i = 0; i < report.size(); i++)
+			std::cout << "sub-mesh " << i << ": ACMR " << report[i].acmr_before << " -> " << report[i].acmr_after << std::endl;
+
+		abd::bake_mesh(paths[1], data, layout);
+	}
+	catch (const std::exception &ex)
+	{
+		std::cerr << "baking failed: " << ex.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
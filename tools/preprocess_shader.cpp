@@ -0,0 +1,48 @@
+#include <albedo/shader_preprocessor.hpp>
+#include <albedo/exception.hpp>
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+/**
+	\file Build-time shader preprocessor - expands includes in a shader
+	the same way the renderer does, so the result can be checked with
+	an offline GLSL compiler.
+
+	Usage: albedo_preprocess_shader <shader dir> <shader> <output>
+		The shader path is relative to the shader directory, which
+		is also used as the include directory.
+*/
+
+int main(int argc, char *argv[])
+{
+	if (argc != 4)
+	{
+		std::cerr << "Usage: " << argv[0] << " <shader dir> <shader> <output>" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		abd::shader_files files{argv[1]};
+		abd::shader_preprocessor preprocessor{{""}, files};
+
+		auto source = files.read(argv[2]);
+		if (!source)
+			throw abd::exception(std::string("could not open shader source file ") + argv[2]);
+
+		auto result = preprocessor.process(abd::shader_source{0, std::move(*source), argv[2]});
+
+		std::ofstream f{argv[3]};
+		f << result.source;
+		if (!f)
+			throw abd::exception(std::string("could not write ") + argv[3]);
+	}
+	catch (const std::exception &ex)
+	{
+		std::cerr << ex.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}